@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/**
+ * Size of a cache line in bytes
+ */
+constexpr std::size_t cacheLineSize = 64;
+
+/**
+ * Allocator that places the first element of every allocation at the start of a cache line
+ */
+template <class T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+    template <class U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{cacheLineSize}));
+    }
+    void deallocate(T* p, std::size_t) { ::operator delete(p, std::align_val_t{cacheLineSize}); }
+
+    template <class U>
+    bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+};
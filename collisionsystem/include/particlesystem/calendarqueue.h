@@ -0,0 +1,241 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+
+#include <algorithm>
+
+/**
+ * Default priority of an element of a CalendarQueue: the element converted to double
+ */
+template <class Comparable>
+struct CalendarKey {
+    double operator()(const Comparable& x) const { return static_cast<double>(x); }
+};
+
+/**
+ * A calendar queue (R. Brown, 1988): a priority queue where the smallest element is removed first
+ *
+ * Elements are hashed on their priority (a double given by Key) into an array of buckets, like
+ * days in a calendar: bucket i holds the elements with priority in [k*width, (k+1)*width)
+ * for all k with k % number of buckets == i. Each bucket is kept sorted. deleteMin scans the
+ * buckets from the current day onwards. The number of buckets follows the queue size and the
+ * bucket width follows the spacing of the smallest priorities, so that both insert and
+ * deleteMin take O(1) amortized time when priorities are spread evenly, e.g. event times in
+ * a discrete event simulation.
+ */
+template <class Comparable, class Key = CalendarKey<Comparable>>
+class CalendarQueue {
+public:
+    /**
+     * Constructor to create an empty queue
+     */
+    explicit CalendarQueue(Key k = Key{}) : key{k} { makeEmpty(); }
+
+    /**
+     * Make the queue empty
+     */
+    void makeEmpty() {
+        buckets.assign(minBuckets, {});
+        width = 1.0;
+        count = 0;
+        currentDay = 0;
+    }
+
+    /**
+     * Check is the queue is empty
+     * Return true if the queue is empty, false otherwise
+     */
+    bool isEmpty() const { return count == 0; }
+
+    /**
+     * Get the size of the queue, i.e. number of elements in the queue
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Get the smallest element in the queue
+     */
+    const Comparable& findMin() {
+        assert(!isEmpty());
+        return buckets[nextBucket()].back();
+    }
+
+    /**
+     * Remove and return the smallest element in the queue
+     */
+    Comparable deleteMin();
+
+    /**
+     * Add a new element x to the queue
+     */
+    void insert(const Comparable& x);
+
+    /**
+     * Add a new element x to the queue, same as insert since a calendar queue is always ordered
+     */
+    void toss(const Comparable& x) { insert(x); }
+
+    /**
+     * Add the elements in [first, last) to the queue
+     */
+    template <class InputIt>
+    void tossRange(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+private:
+    static constexpr size_t minBuckets = 2;
+    static constexpr size_t widthSamples = 25;  // elements used to estimate the bucket width
+
+    std::vector<std::vector<Comparable>> buckets;  // each sorted in decreasing order
+    double width;                                  // length of the priority interval of a day
+    size_t count;                                  // number of elements in the queue
+    std::int64_t currentDay;  // day, i.e. floor(priority / width), of the last removed element
+    Key key;                  // priority of an element
+
+    // Auxiliary member functions
+
+    /**
+     * Day of priority p, days too far from zero to be represented are merged into the first or
+     * last representable day
+     */
+    std::int64_t dayOf(double p) const {
+        return static_cast<std::int64_t>(std::clamp(std::floor(p / width), -0x1p62, 0x1p62));
+    }
+
+    /**
+     * Bucket of day d
+     */
+    size_t bucketOf(std::int64_t d) const {
+        const auto n = static_cast<std::int64_t>(buckets.size());
+        return static_cast<size_t>(((d % n) + n) % n);
+    }
+
+    /**
+     * Find the bucket holding the smallest element, and make its day the current day
+     */
+    size_t nextBucket();
+
+    /**
+     * Rebuild the calendar with n buckets and a bucket width suited for the current elements
+     */
+    void resize(size_t n);
+};
+
+/**
+ * Find the bucket holding the smallest element, and make its day the current day
+ */
+template <class Comparable, class Key>
+size_t CalendarQueue<Comparable, Key>::nextBucket() {
+    assert(!isEmpty());
+
+    // scan one year of days, starting with the current day
+    for (size_t n = 0; n < buckets.size(); ++n, ++currentDay) {
+        const auto& b = buckets[bucketOf(currentDay)];
+        if (!b.empty() && dayOf(key(b.back())) <= currentDay) {
+            return bucketOf(currentDay);
+        }
+    }
+
+    // nothing in the coming year: search all buckets for the smallest element
+    size_t smallest = buckets.size();
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (!buckets[i].empty() &&
+            (smallest == buckets.size() || buckets[i].back() < buckets[smallest].back())) {
+            smallest = i;
+        }
+    }
+    currentDay = dayOf(key(buckets[smallest].back()));
+    return smallest;
+}
+
+/**
+ * Remove and return the smallest element in the queue
+ */
+template <class Comparable, class Key>
+Comparable CalendarQueue<Comparable, Key>::deleteMin() {
+    assert(!isEmpty());
+
+    auto& b = buckets[nextBucket()];
+    Comparable x = std::move(b.back());
+    b.pop_back();
+    --count;
+
+    if (buckets.size() > minBuckets && count < buckets.size() / 2) {
+        resize(buckets.size() / 2);
+    }
+    return x;
+}
+
+/**
+ * Add a new element x to the queue
+ */
+template <class Comparable, class Key>
+void CalendarQueue<Comparable, Key>::insert(const Comparable& x) {
+    const std::int64_t day = dayOf(key(x));
+    if (count == 0 || day < currentDay) {  // x is the next element to be removed
+        currentDay = day;
+    }
+
+    // keep the bucket sorted in decreasing order, equal elements are removed in insertion order
+    auto& b = buckets[bucketOf(day)];
+    const auto pos = std::lower_bound(b.begin(), b.end(), x,
+                                      [](const Comparable& a, const Comparable& c) { return c < a; });
+    b.insert(pos, x);
+    ++count;
+
+    if (count > 2 * buckets.size()) {
+        resize(2 * buckets.size());
+    }
+}
+
+/**
+ * Rebuild the calendar with n buckets and a bucket width suited for the current elements
+ */
+template <class Comparable, class Key>
+void CalendarQueue<Comparable, Key>::resize(size_t n) {
+    std::vector<Comparable> all;
+    all.reserve(count);
+    for (auto& b : buckets) {
+        std::move(b.begin(), b.end(), std::back_inserter(all));
+    }
+
+    // bucket width: three times the average separation of the smallest priorities,
+    // ignoring separations more than twice the average and those of equal priorities, but at
+    // least a small fraction of the priorities, so that days of later priorities stay small
+    const size_t samples = std::min(all.size(), widthSamples);
+    if (samples > 1) {
+        std::partial_sort(all.begin(), all.begin() + samples, all.end());
+        const double average = (key(all[samples - 1]) - key(all[0])) / (samples - 1);
+
+        double sum = 0.0;
+        size_t gaps = 0;
+        for (size_t i = 1; i < samples; ++i) {
+            const double gap = key(all[i]) - key(all[i - 1]);
+            if (gap > 0.0 && gap <= 2.0 * average) {
+                sum += gap;
+                ++gaps;
+            }
+        }
+        if (sum > 0.0) {
+            const double magnitude =
+                std::max(std::abs(key(all[0])), std::abs(key(all[samples - 1])));
+            width = std::max(3.0 * sum / gaps, magnitude * 0x1p-40);
+        }
+    }
+
+    const size_t elements = count;
+    buckets.assign(n, {});
+    count = 0;
+    for (const auto& x : all) {
+        insert(x);
+    }
+    assert(count == elements);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include <particlesystem/particle.h>
+
+namespace particlesystem {
+
+/**
+ * State of a simulation at a given time, from which the simulation can be resumed
+ * All particles are at their positions at time, and keep their collision counts
+ *
+ * A checkpoint file is
+ *   char[4] magic "PSCK", uint32 version, uint64 number of particles n, float64 time,
+ *   then n times: float64 rx, ry, vx, vy, radius, mass, float32 red, green, blue, int32 count
+ * in the byte order of the machine writing it, without padding.
+ */
+struct Checkpoint {
+    static constexpr std::uint32_t version = 1;
+
+    double time = 0.0;
+    std::vector<Particle> particles;
+};
+
+/**
+ * Return true if file starts like a checkpoint file
+ */
+bool is_checkpoint_file(const std::filesystem::path& file);
+
+/**
+ * Write the state of the particles at time to a checkpoint file
+ * The file is replaced atomically, a crash while writing leaves the previous checkpoint intact
+ * \throw std::runtime_error if the file cannot be written
+ */
+void write_checkpoint(const std::filesystem::path& file, double time,
+                      std::span<const Particle> particles);
+
+/**
+ * Read a checkpoint file
+ * \throw std::runtime_error if the file cannot be read or is not a valid checkpoint
+ */
+Checkpoint read_checkpoint(const std::filesystem::path& file);
+
+}  // namespace particlesystem
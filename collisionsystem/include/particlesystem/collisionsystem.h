@@ -1,62 +1,358 @@
-#pragma once
-
-#include <iostream>
-#include <utility>
-#include <vector>
-#include <span>
-#include <functional>
-
-#include <particlesystem/priorityqueue.h>
-#include <particlesystem/event.h>
-#include <particlesystem/particle.h>
-
-namespace particlesystem {
-
-/**
- *  CollisionSystem class represents a collection of particles
- *  moving in the unit box, according to the laws of elastic collision.
- *  This event-based simulation relies on a priority queue.
- */
-class CollisionSystem {
-public:
-    /**
-     * Constructor to create a system with the specified collection of particles
-     * The individual particles will be mutated during the simulation
-     */
-    CollisionSystem(std::vector<Particle> particles);
-
-    // Disable copying
-    CollisionSystem(const CollisionSystem&) = delete;
-    CollisionSystem& operator=(const CollisionSystem&) = delete;
-
-    /**
-     * Simulate the system of particles for the specified amount of simulationTime
-     * renderFrequenzy is the number of times the particles are rendered per time unit
-     */
-    void simulate(double simulationTime, double renderFrequenzy);
-
-    /**
-     * Returns the kinetic energy of the particles system
-     */
-    double kineticEnergy() const;
-
-    /**
-     * Return a vector with all system particles
-     */
-    const std::vector<Particle>& particles() const;
-
-    // To be used by for rendering
-    std::function<void(std::span<Particle>)> renderCallback;
-    std::function<bool()> abortCallback;
-
-private:
-    /**
-     * Update priority queue with all new events for particle
-     */
-    void predict(PriorityQueue<Event>& queue, Particle& particle, double currentTime,
-                 double simulationTime);
-
-    std::vector<Particle> particles_;  // the particles
-};
-
-}  // namespace particlesystem
+#pragma once
+
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <span>
+#include <functional>
+#include <cstdint>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+
+#include <particlesystem/priorityqueue.h>
+#include <particlesystem/indexedpriorityqueue.h>
+#include <particlesystem/event.h>
+#include <particlesystem/particle.h>
+#include <particlesystem/particlestore.h>
+#include <particlesystem/checkpoint.h>
+#include <particlesystem/conservation.h>
+
+namespace particlesystem {
+
+/**
+ *  CollisionSystem class represents a collection of particles
+ *  moving in the unit box, according to the laws of elastic collision.
+ *  This event-based simulation relies on a priority queue.
+ */
+class CollisionSystem {
+public:
+    /**
+     * How candidate collision partners are found when predicting events
+     *   - AllPairs: every particle is tested against all other particles, O(N) per prediction
+     *   - CellList: the unit box is divided into a uniform grid of cells at least one particle
+     *               diameter wide, and a particle is only tested against particles in its own
+     *               and the 8 neighboring cells. Cell-crossing events keep the grid up to date.
+     *               With Scheduling::AllEvents the results are identical to AllPairs: a cell
+     *               crossing does not move the particle, and a pair that becomes neighbors is
+     *               predicted as AllPairs predicted it. With OnePerParticle and Parallel a
+     *               particle is predicted again from its position at each cell crossing, which
+     *               rounds differently. The motion is chaotic, so these differences grow from
+     *               about 1e-14 after a few collisions per particle to different trajectories
+     *               after a few hundred.
+     */
+    enum class Neighborhood { AllPairs, CellList };
+
+    /**
+     * How predicted events are kept in the event queue
+     *   - AllEvents: every predicted event is added to the event queue (see QueueBackend),
+     *                events invalidated by later collisions are discarded when they reach
+     *                the front of the queue
+     *   - OnePerParticle: an IndexedPriorityQueue holds only the earliest event of each
+     *                particle, which is replaced when the particle or its partner changes
+     *                velocity. The queue never holds more than N+1 events.
+     *   - Parallel:  as OnePerParticle, but the cell list is divided into vertical strips that
+     *                are simulated by separate threads (see Options::threads). The results are
+     *                identical to OnePerParticle. Requires Neighborhood::CellList with enough
+     *                cells for two strips, otherwise the simulation runs as OnePerParticle.
+     *                Pays off for large systems, where few events happen near the strip
+     *                boundaries.
+     */
+    enum class Scheduling { AllEvents, OnePerParticle, Parallel };
+
+    /**
+     * The event queue used with Scheduling::AllEvents
+     *   - BinaryHeap: PriorityQueue, O(log n) insert and deleteMin
+     *   - Calendar: CalendarQueue, O(1) amortized insert and deleteMin for event times spread
+     *               evenly over the simulation time
+     */
+    enum class QueueBackend { BinaryHeap, Calendar };
+
+    /**
+     * Simulation options, chosen when the system is created
+     */
+    struct Options {
+        Neighborhood neighborhood = Neighborhood::AllPairs;
+        Scheduling scheduling = Scheduling::AllEvents;
+        QueueBackend queue = QueueBackend::BinaryHeap;
+        std::filesystem::path statisticsFile;  // if not empty, statistics are appended to this
+                                               // file at every rendering event, one JSON
+                                               // object per line
+        std::filesystem::path checkpointFile;  // if not empty, a Checkpoint is written to this
+        double checkpointInterval = 0.0;       // file at the first rendering event after each
+                                               // interval of simulation time (and at the end)
+        unsigned threads = 0;                  // threads of Scheduling::Parallel, 0 for one per
+                                               // hardware thread
+        bool printProgress = true;             // print the simulation time at every rendering
+                                               // event
+        double driftTolerance = 0.0;           // largest relative drift of the kinetic energy
+                                               // before driftCallback is called, 0 to not check
+    };
+
+    /**
+     * Counters and timers of the last (or current) call to simulate
+     * Times are wall-clock seconds. Scheduling::Parallel only measures the total time.
+     */
+    struct Statistics {
+        double simulationTime = 0.0;        // simulation clock
+        std::uint64_t eventsProcessed = 0;  // valid events processed, including rendering
+        std::uint64_t staleEvents = 0;      // invalidated events discarded (AllEvents only)
+        std::size_t peakQueueSize = 0;      // largest number of events in the queue
+        double predictSeconds = 0.0;        // predicting events
+        double deleteMinSeconds = 0.0;      // removing events from the queue
+        double moveSeconds = 0.0;           // moving particles to the current time
+        double totalSeconds = 0.0;          // simulate, so far
+        double energyDrift = 0.0;           // relative change of the kinetic energy since the
+                                            // system was created
+
+        /**
+         * Return the number of events processed per second
+         */
+        double eventsPerSecond() const {
+            return totalSeconds > 0.0 ? eventsProcessed / totalSeconds : 0.0;
+        }
+
+        /**
+         * Return the statistics as a JSON object, on a single line
+         */
+        std::string toJson() const;
+    };
+
+    /**
+     * A processed event, as reported to eventCallback
+     * Particles are given by their index in particles(), noParticle if not involved
+     * Events involving a single particle, e.g. wall collisions, give it as particleA
+     */
+    struct EventRecord {
+        static constexpr std::uint32_t noParticle = 0xffffffff;
+
+        double time;
+        EventType type;
+        std::uint32_t particleA;
+        std::uint32_t particleB;
+    };
+
+    /**
+     * Constructor to create a system with the specified collection of particles
+     * The individual particles will be mutated during the simulation
+     */
+    CollisionSystem(std::vector<Particle> particles);
+
+    /**
+     * Constructor to create a system with the specified collection of particles and options
+     * The individual particles will be mutated during the simulation
+     */
+    CollisionSystem(std::vector<Particle> particles, Options options);
+
+    /**
+     * Constructor to resume a simulation from a checkpoint, see Options::checkpointFile
+     * The simulation clock starts at the time of the checkpoint
+     */
+    CollisionSystem(Checkpoint checkpoint, Options options);
+
+    // Disable copying
+    CollisionSystem(const CollisionSystem&) = delete;
+    CollisionSystem& operator=(const CollisionSystem&) = delete;
+
+    /**
+     * Simulate the system of particles until the simulation clock reaches simulationTime
+     * The clock starts at zero, or at the time of the checkpoint the system was resumed from,
+     * and continues from the last event of the previous call, if any
+     * renderFrequenzy is the number of times the particles are rendered per time unit
+     */
+    void simulate(double simulationTime, double renderFrequenzy);
+
+    /**
+     * Return the simulation clock: the time of the last event processed
+     */
+    double time() const { return clock_; }
+
+    /**
+     * Write a checkpoint of the current state of the system to file, between calls to simulate
+     */
+    void checkpoint(const std::filesystem::path& file);
+
+    /**
+     * Returns the kinetic energy of the particles system
+     * The energy is tracked during the simulation, see ConservationMonitor
+     */
+    double kineticEnergy() const { return conservation_.totals().energy; }
+
+    /**
+     * Return the total momentum of the particles system, tracked as the kinetic energy
+     */
+    glm::dvec2 momentum() const { return conservation_.totals().momentum; }
+
+    /**
+     * Return a vector with all system particles
+     */
+    const std::vector<Particle>& particles() const;
+
+    /**
+     * Return the statistics of the last (or current) simulation
+     */
+    const Statistics& statistics() const { return stats_; }
+
+    // To be used by for rendering, both are optional
+    std::function<void(std::span<Particle>)> renderCallback;
+    std::function<bool()> abortCallback;
+
+    // Optional, called for every valid event before it is processed, in simulation order
+    std::function<void(const EventRecord&)> eventCallback;
+
+    // Optional, called with the simulation time and the relative drift of the kinetic energy
+    // when the drift exceeds Options::driftTolerance, again only after it was back within
+    std::function<void(double, double)> driftCallback;
+
+private:
+    /**
+     * Collision candidates of the particle being predicted
+     * Each thread predicting events needs its own
+     */
+    struct Candidates {
+        ParticleStore store;        // trajectories of the candidates, gathered by gatherCell
+        std::vector<size_t> index;  // index in particles_ of each candidate
+        std::vector<double> times;  // time to hit each candidate
+    };
+
+    /**
+     * Main simulation loop of Scheduling::AllEvents, with the given (empty) event queue
+     */
+    template <class Queue>
+    void simulateAllEvents(Queue& queue, double simulationTime, double renderFrequenzy);
+
+    /**
+     * Main simulation loop of Scheduling::OnePerParticle
+     */
+    void simulateOnePerParticle(double simulationTime, double renderFrequenzy);
+
+    /**
+     * Main simulation loop of Scheduling::Parallel, see StripScheduler
+     */
+    void simulateParallel(double simulationTime, double renderFrequenzy);
+
+    class StripScheduler;
+
+    /**
+     * Add to events all new events for particle
+     */
+    void predict(std::vector<Event>& events, Particle& particle, double currentTime,
+                 double simulationTime);
+
+    /**
+     * Add to events all new events for particle, using the given candidates buffer
+     * Only collisions with the particles with index first, first+1, ... are predicted
+     * Does not modify the system, so several threads can predict at the same time
+     */
+    void predict(std::vector<Event>& events, Candidates& candidates, Particle& particle,
+                 double currentTime, double simulationTime, size_t first);
+
+    /**
+     * Predict the events of all particles at the start of the simulation, in parallel
+     * Each pair of particles is predicted once, by the particle with the smaller index
+     * Return the events in buffers that hold the events of consecutive particles, in
+     * particle order, so the result does not depend on the number of threads
+     */
+    std::vector<std::vector<Event>> predictAll(double currentTime, double simulationTime);
+
+    /**
+     * Add to events all collisions of particle with the candidates gathered by gatherCell
+     */
+    void predictCandidates(std::vector<Event>& events, Candidates& candidates, Particle& particle,
+                           double currentTime, double simulationTime);
+
+    /**
+     * Add the particles stored in cell (cx, cy), with index first or larger, to the
+     * candidates, if the cell exists
+     */
+    void gatherCell(Candidates& candidates, int cx, int cy, size_t first = 0) const;
+
+    /**
+     * Add to events the event of particle leaving its current cell
+     */
+    void predictCellCrossing(std::vector<Event>& events, Particle& particle, double currentTime,
+                             double simulationTime) const;
+
+    /**
+     * Add to events the collisions of particle with particles in the cells that became
+     * neighbors when particle left previousCell, followed by its next cell crossing
+     */
+    void predictNewNeighbors(std::vector<Event>& events, Particle& particle, int previousCell,
+                             double currentTime, double simulationTime);
+
+    /**
+     * Move particle to the given cell of the cell list
+     * Return the cell the particle was in before
+     */
+    int enterCell(Particle& particle, int cell);
+
+    /**
+     * Move all particles to their positions at time t
+     * During the simulation, particles are only moved when they take part in an event
+     */
+    void synchronize(double t);
+
+    /**
+     * Update the clocks of the statistics at simulation time currentTime
+     */
+    void updateStatistics(double currentTime);
+
+    /**
+     * Append the statistics to the statistics file, if any
+     */
+    void dumpStatistics();
+
+    /**
+     * Report event e to eventCallback, if any
+     */
+    void report(const Event& e) const;
+
+    /**
+     * Add the change of the kinetic energy and momentum in an event at currentTime to the
+     * totals, and check the drift of the energy
+     */
+    void track(const EnergyMomentum& change, double currentTime);
+
+    /**
+     * Process a rendering event at currentTime
+     * Return true if the simulation should be aborted
+     */
+    bool render(double currentTime, size_t queueSize);
+
+    /**
+     * Return the index of the grid cell that contains position r
+     */
+    int cellIndex(const glm::dvec2& r) const;
+
+    /**
+     * Return the index of particle in particles_
+     */
+    size_t indexOf(const Particle* particle) const { return particle - particles_.data(); }
+
+    /**
+     * Return the particle with index i of an event, null if i is Event::none
+     */
+    Particle* particle(std::uint32_t i) { return i != Event::none ? &particles_[i] : nullptr; }
+
+    std::vector<Particle> particles_;  // the particles
+    Options options_;                  // simulation options
+    double clock_ = 0.0;               // simulation clock between calls to simulate
+    double nextCheckpoint_ = 0.0;      // simulation time of the next checkpoint
+    ParticleStore store_;              // trajectories of particles_, updated on velocity changes
+    Candidates candidates_;            // candidates buffer of the simulation loop
+
+    ConservationMonitor conservation_;  // total kinetic energy and momentum
+    bool drifted_ = false;              // energy drift above Options::driftTolerance
+
+    Statistics stats_;                                  // statistics of the simulation
+    std::chrono::steady_clock::time_point startTime_;  // when simulate was called
+    std::ofstream statisticsOut_;                       // statistics file, if any
+
+    // Cell list, only used with Neighborhood::CellList
+    int gridSize_ = 0;                           // number of cells per side, 0 if no cell list
+    std::vector<std::vector<Particle*>> cells_;  // particles in each cell, row-major
+    std::vector<int> cellOf_;                    // cell of each particle, indexed as particles_
+};
+
+}  // namespace particlesystem
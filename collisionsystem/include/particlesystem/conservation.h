@@ -0,0 +1,84 @@
+#pragma once
+
+#include <span>
+
+#include <particlesystem/particle.h>
+
+namespace particlesystem {
+
+/**
+ * Sum of floating-point numbers that keeps the rounding errors of the additions in a separate
+ * compensation term (Neumaier's variant of Kahan summation), so the result is as accurate as
+ * if it was computed in twice the precision and then rounded
+ */
+class CompensatedSum {
+public:
+    /**
+     * Add x to the sum
+     */
+    void add(double x);
+
+    /**
+     * Return the sum
+     */
+    double value() const { return sum_ + compensation_; }
+
+private:
+    double sum_ = 0.0;
+    double compensation_ = 0.0;  // rounding errors of the additions to sum_
+};
+
+/**
+ * Total kinetic energy and momentum of a collection of particles, kept up to date by adding
+ * the changes of each event in O(1), see Particle::bounceOff
+ * Elastic collisions conserve the energy, so the drift of the energy from its value at the
+ * reference (the last reset) measures the rounding errors of the simulation. Momentum is only
+ * conserved by particle-particle collisions, the walls change it.
+ * The tracked totals are only as accurate as the changes added, so resync recomputes them from
+ * the particles from time to time
+ */
+class ConservationMonitor {
+public:
+    ConservationMonitor() = default;
+
+    /**
+     * Constructor to track the particles, with their current energy as reference
+     */
+    explicit ConservationMonitor(std::span<const Particle> particles) { reset(particles); }
+
+    /**
+     * Recompute the totals from the particles and make the energy the reference
+     */
+    void reset(std::span<const Particle> particles);
+
+    /**
+     * Recompute the totals from the particles, keeping the reference, in O(n)
+     */
+    void resync(std::span<const Particle> particles);
+
+    /**
+     * Add the change of the particles in an event, in O(1)
+     */
+    void add(const EnergyMomentum& change);
+
+    /**
+     * Return the total kinetic energy and momentum
+     */
+    EnergyMomentum totals() const {
+        return {energy_.value(), {momentumX_.value(), momentumY_.value()}};
+    }
+
+    /**
+     * Return the relative change of the energy since the reference, zero if the reference
+     * energy is zero
+     */
+    double energyDrift() const;
+
+private:
+    CompensatedSum energy_;
+    CompensatedSum momentumX_;
+    CompensatedSum momentumY_;
+    double reference_ = 0.0;  // energy at the last reset
+};
+
+}  // namespace particlesystem
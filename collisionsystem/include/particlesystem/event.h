@@ -1,72 +1,144 @@
-#pragma once
-
-#include <iostream>
-#include <compare>
-
-#include <particlesystem/particle.h>
-
-namespace particlesystem {
-
-class CollisionSystem;
-
-/**
- *  An event during a particle collision simulation. Each event contains
- *  the time at which it will occur and the particles a and b involved.
- *  There are 4 types of events:
- *    -  a and b both null:      rendering event
- *    -  a null, b not null:     collision with vertical wall
- *    -  a not null, b null:     collision with horizontal wall
- *    -  a and b both not null:  binary collision between a and b
- *
- */
-class Event {
-public:
-    /**
-     * Constructor to create a new event to occur at time t involving two particles
-     */
-    explicit Event(double t = 0.0, Particle* ptrA = nullptr, Particle* ptrB = nullptr);
-
-    /*
-     * Overloaded three-way comparison operator: chronological comparison using time
-     */
-    auto operator<=>(const Event& e) const { return time <=> e.time; }
-
-    /**
-     * To check whether any collision occurred between when event was created and now
-     */
-    bool isValid() const;
-
-    friend CollisionSystem;
-
-private:
-    double time;          // time that event is scheduled to occur
-    Particle* particleA;  // particle involved in event, possibly null
-    Particle* particleB;  // particle involved in event, possibly null
-    int countA;           // collision count at event creation
-    int countB;           // collision count at event creation
-};
-
-/**
- * Constructor to create a new event to occur at time t involving two particles
- */
-inline Event::Event(double t, Particle* ptrA, Particle* ptrB)
-    : time{t}
-    , particleA{ptrA}
-    , particleB{ptrB}
-    , countA{particleA != nullptr ? particleA->counter() : -1}
-    , countB{particleB != nullptr ? particleB->counter() : -1} {}
-
-/**
- * To check whether any collision occurred between when event was created and now
- */
-inline bool Event::isValid() const {
-    if (particleA != nullptr && particleA->counter() != countA) {
-        return false;
-    }
-    if (particleB != nullptr && particleB->counter() != countB) {
-        return false;
-    }
-    return true;
-}
-
-}  // namespace particlesystem
+#pragma once
+
+#include <iostream>
+#include <compare>
+#include <cstdint>
+#include <cassert>
+#include <span>
+
+#include <particlesystem/particle.h>
+
+namespace particlesystem {
+
+class CollisionSystem;
+
+/**
+ * The type of an event, named after the Particle member function that processes it
+ */
+enum class EventType : std::uint8_t {
+    Render,          // a and b none
+    VerticalWall,    // a bounces off a vertical wall, b none
+    HorizontalWall,  // a bounces off a horizontal wall, b none
+    Collision,       // a and b collide
+    CellCrossing     // a enters cell b
+};
+
+/**
+ *  An event during a particle collision simulation. Each event contains
+ *  the time at which it will occur, its type and the indices a and b of the particles involved
+ *  (Event::none if not involved):
+ *    -  Render:          rendering event, a and b none
+ *    -  VerticalWall:    collision of a with vertical wall
+ *    -  HorizontalWall:  collision of a with horizontal wall
+ *    -  Collision:       binary collision between a and b
+ *  A fifth type, CellCrossing, is only used when the collision system runs with a
+ *  cell list: a enters the cell with index b.
+ *
+ *  An event takes 24 bytes, the collision count of b is stored modulo 2^29.
+ */
+class Event {
+public:
+    static constexpr std::uint32_t none = 0xffffffff;  // index of no particle
+
+    /**
+     * Constructor to create a new rendering event to occur at time t
+     */
+    explicit Event(double t = 0.0) : Event(t, EventType::Render, none, none, {}) {}
+
+    /**
+     * Constructor to create a new event of the given type to occur at time t involving
+     * particles a and b, or particle a and cell b for EventType::CellCrossing
+     * The collision counts are taken from particles, indexed by a and b
+     */
+    Event(double t, EventType type, std::uint32_t a, std::uint32_t b,
+          std::span<const Particle> particles);
+
+    /*
+     * Overloaded three-way comparison operator: chronological comparison using time
+     * Events at the same time are ordered by particle a, so the order in which events are
+     * processed does not depend on the layout of the event queue. Rendering events (a none)
+     * come after the particle events at the same time.
+     */
+    std::partial_ordering operator<=>(const Event& e) const {
+        if (const auto c = time <=> e.time; c != 0) {
+            return c;
+        }
+        return particleA <=> e.particleA;
+    }
+
+    /**
+     * To check whether any collision occurred between when event was created and now
+     * particles must be the collection the event was created with
+     */
+    bool isValid(std::span<const Particle> particles) const;
+
+    /**
+     * Return the time at which the event is scheduled to occur
+     */
+    double getTime() const { return time; }
+
+    /**
+     * Return the type of the event
+     */
+    EventType type() const { return static_cast<EventType>(tag); }
+
+    /**
+     * Check whether this is a cell-crossing event
+     */
+    bool isCellCrossing() const { return type() == EventType::CellCrossing; }
+
+    /**
+     * Return the cell entered by a cell-crossing event
+     */
+    int cell() const {
+        assert(isCellCrossing());
+        return static_cast<int>(particleB);
+    }
+
+    friend CollisionSystem;
+
+private:
+    static constexpr std::uint32_t countBits = 29;
+    static constexpr std::uint32_t countMask = (1u << countBits) - 1;
+
+    double time;                         // time that event is scheduled to occur
+    std::uint32_t particleA;             // particle involved in event, possibly none
+    std::uint32_t particleB;             // particle involved in event, possibly none,
+                                         // or the cell entered by a cell-crossing event
+    std::uint32_t countA;                // collision count of a at event creation
+    std::uint32_t countB : countBits;    // collision count of b at event creation, truncated
+    std::uint32_t tag : 32 - countBits;  // EventType
+};
+
+static_assert(sizeof(Event) == 24, "Event should be packed into 24 bytes");
+
+/**
+ * Constructor to create a new event of the given type to occur at time t involving
+ * particles a and b, or particle a and cell b for EventType::CellCrossing
+ */
+inline Event::Event(double t, EventType type, std::uint32_t a, std::uint32_t b,
+                    std::span<const Particle> particles)
+    : time{t}
+    , particleA{a}
+    , particleB{b}
+    , countA{a != none ? static_cast<std::uint32_t>(particles[a].counter()) : 0}
+    , countB{type == EventType::Collision
+                 ? static_cast<std::uint32_t>(particles[b].counter()) & countMask
+                 : 0}
+    , tag{static_cast<std::uint32_t>(type)} {}
+
+/**
+ * To check whether any collision occurred between when event was created and now
+ */
+inline bool Event::isValid(std::span<const Particle> particles) const {
+    if (particleA != none && static_cast<std::uint32_t>(particles[particleA].counter()) != countA) {
+        return false;
+    }
+    if (type() == EventType::Collision &&
+        (static_cast<std::uint32_t>(particles[particleB].counter()) & countMask) != countB) {
+        return false;
+    }
+    return true;
+}
+
+}  // namespace particlesystem
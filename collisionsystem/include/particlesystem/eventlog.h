@@ -0,0 +1,57 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+
+#include <particlesystem/particle.h>
+#include <particlesystem/collisionsystem.h>
+
+namespace particlesystem {
+
+/**
+ * Binary log of a simulation run, to replay runs and compare them byte for byte
+ *
+ * The file starts with a header
+ *   char[4] magic "PSEL", uint32 version, uint32 number of particles
+ * followed by records, each starting with a uint8 record kind:
+ *   'E' event:    float64 time, uint8 EventType, uint32 particle a, uint32 particle b
+ *   'S' snapshot: float64 time, uint32 n, then n times float64 rx, ry, vx, vy
+ * Particles are given by their index in the particles file, 0xffffffff if not involved.
+ * Events involving a single particle give it as particle a (since version 2).
+ * Values are stored in the byte order of the machine writing the log (little-endian on
+ * all supported platforms), without padding.
+ */
+class EventLog {
+public:
+    static constexpr std::uint32_t version = 2;
+
+    /**
+     * Constructor to create the log file for a system of particleCount particles
+     * \throw std::runtime_error if the file cannot be created
+     */
+    EventLog(const std::filesystem::path& file, size_t particleCount);
+
+    /**
+     * Append a processed event
+     */
+    void write(const CollisionSystem::EventRecord& e);
+
+    /**
+     * Append a snapshot of the positions and velocities of the particles at the given time
+     */
+    void writeSnapshot(double time, std::span<const Particle> particles);
+
+private:
+    /**
+     * Append the bytes of x
+     * \throw std::runtime_error if writing fails, e.g. the disk is full
+     */
+    template <class T>
+    void put(const T& x);
+
+    std::ofstream out_;
+};
+
+}  // namespace particlesystem
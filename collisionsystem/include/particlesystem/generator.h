@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <particlesystem/particle.h>
+
+namespace particlesystem {
+
+/**
+ * Distribution of a property of the generated particles, relative to its mean
+ *   - Constant:  every particle has the mean
+ *   - Uniform:   uniform in [mean * (1 - spread), mean * (1 + spread)], spread in [0, 1]
+ *   - LogNormal: log-normal with the mean and relative standard deviation spread
+ */
+struct Distribution {
+    enum class Kind { Constant, Uniform, LogNormal };
+
+    Kind kind = Kind::Constant;
+    double spread = 0.0;
+};
+
+/**
+ * Parameters of a synthetic particle system, see generate_particles
+ */
+struct GeneratorOptions {
+    std::size_t count = 1000;   // number of particles
+    double density = 0.1;       // fraction of the unit box covered by the particles
+    Distribution radius;        // radii, scaled to give the density
+    Distribution mass;          // masses, with mean 1
+    bool massFromArea = false;  // if true, masses are also proportional to the area
+    double speed = 0.01;        // root mean square speed, of a Maxwell-Boltzmann distribution
+    std::uint64_t seed = 1;     // seed of the random number generator
+};
+
+/**
+ * Generate a particle system in the unit box, without overlapping particles
+ * The particles are placed one at a time, largest first, at random positions that do not
+ * overlap the particles placed before (random sequential addition). This works up to a
+ * density of about 0.5 for equal radii, somewhat more for a wide radius distribution.
+ * The result depends only on the options, for a given standard library.
+ * \throw std::runtime_error if a particle cannot be placed
+ */
+std::vector<Particle> generate_particles(const GeneratorOptions& options);
+
+}  // namespace particlesystem
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <stdexcept>
+
+#include <algorithm>
+
+#include <particlesystem/priorityqueue.h>  // HeapCheck
+
+/**
+ * A heap based priority queue where the root is the smallest element -- min heap
+ * Each element is associated with a handle in the range [0, capacity), given on insertion,
+ * and at most one element per handle can be stored in the queue. The handle can be used to
+ * change the element's key (e.g. decrease-key) or to remove the element from the queue.
+ */
+template <class Comparable>
+class IndexedPriorityQueue {
+public:
+    /**
+     * Constructor to create an empty queue for handles 0, 1, ..., capacity-1
+     */
+    explicit IndexedPriorityQueue(size_t capacity = 100)
+        : pq(1), keys(capacity), position(capacity, 0) {
+        pq.reserve(capacity + 1);
+        assert(isEmpty());
+    }
+
+    /**
+     * Make the queue empty
+     */
+    void makeEmpty() {
+        for (size_t i = 1; i < pq.size(); ++i) {
+            position[pq[i]] = 0;
+        }
+        pq.resize(1);
+    }
+
+    /**
+     * Check is the queue is empty
+     * Return true if the queue is empty, false otherwise
+     */
+    bool isEmpty() const {
+        return pq.size() == 1;  // slot zero is not used
+    }
+
+    /**
+     * Get the size of the queue, i.e. number of elements in the queue
+     */
+    size_t size() const { return pq.size() - 1; }
+
+    /**
+     * Get the largest handle that can be used plus one
+     */
+    size_t capacity() const { return position.size(); }
+
+    /**
+     * Increase the capacity, so that the handles 0, 1, ..., capacity-1 can be used
+     */
+    void reserve(size_t capacity) {
+        if (capacity > position.size()) {
+            keys.resize(capacity);
+            position.resize(capacity, 0);
+        }
+    }
+
+    /**
+     * Check whether the queue stores an element for handle h
+     */
+    bool contains(size_t h) const {
+        assert(h < capacity());
+        return position[h] != 0;
+    }
+
+    /**
+     * Get the element stored for handle h
+     */
+    const Comparable& get(size_t h) const {
+        assert(contains(h));
+        return keys[h];
+    }
+
+    /**
+     * Get the smallest element in the queue
+     */
+    const Comparable& findMin() const {
+        assert(!isEmpty());
+        return keys[pq[1]];
+    }
+
+    /**
+     * Get the handle of the smallest element in the queue
+     */
+    size_t minHandle() const {
+        assert(!isEmpty());
+        return pq[1];
+    }
+
+    /**
+     * Remove and return the smallest element in the queue
+     */
+    Comparable deleteMin();
+
+    /**
+     * Add a new element x with handle h to the queue
+     * No element with handle h can be stored in the queue
+     */
+    void insert(size_t h, const Comparable& x);
+
+    /**
+     * Replace the element with handle h by a smaller or equal element x
+     */
+    void decreaseKey(size_t h, const Comparable& x);
+
+    /**
+     * Replace the element with handle h by x, or insert x if there is no element with handle h
+     */
+    void update(size_t h, const Comparable& x);
+
+    /**
+     * Remove the element with handle h from the queue, if any
+     */
+    void remove(size_t h);
+
+private:
+    std::vector<size_t> pq;        // heap of handles, slot with index 0 not used
+    std::vector<Comparable> keys;  // element of each handle
+    std::vector<size_t> position;  // index in pq of each handle, 0 if not in the queue
+    HeapCheck check;               // when to validate the heap
+
+    // Auxiliary member functions
+
+    /**
+     * Place the handle h in slot i of the heap
+     */
+    void place(size_t i, size_t h) {
+        pq[i] = h;
+        position[h] = i;
+    }
+
+    void percolateUp(size_t i);
+
+    void percolateDown(size_t i);
+
+    /**
+     * Validate the heap, if required by the build options (see priorityqueue.h)
+     */
+    void checkHeap() {
+        if (check.due() && !isMinHeap()) {
+            throw std::logic_error("IndexedPriorityQueue: heap order violated");
+        }
+    }
+
+    /**
+     * Test whether pq is a min heap and position is the inverse of pq
+     */
+    bool isMinHeap() const {
+        for (size_t i = 1; i < pq.size(); ++i) {
+            if (position[pq[i]] != i) {
+                return false;
+            }
+            if (i > 1 && keys[pq[i]] < keys[pq[i / 2]]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+template <class Comparable>
+void IndexedPriorityQueue<Comparable>::percolateUp(size_t i) {
+    const size_t h = pq[i];
+
+    for (; i > 1 && keys[h] < keys[pq[i / 2]]; i /= 2) {
+        place(i, pq[i / 2]);
+    }
+    place(i, h);
+}
+
+template <class Comparable>
+void IndexedPriorityQueue<Comparable>::percolateDown(size_t i) {
+    const size_t h = pq[i];
+    auto c = 2 * i;  // left child
+
+    while (c < pq.size()) {
+        if (c < pq.size() - 1 && keys[pq[c + 1]] < keys[pq[c]]) {  // smallest child?
+            c++;
+        }
+        if (keys[pq[c]] < keys[h]) {
+            place(i, pq[c]);
+            i = c;
+            c = 2 * i;
+        } else {
+            break;
+        }
+    }
+    place(i, h);
+}
+
+/**
+ * Remove and return the smallest element in the queue
+ */
+template <class Comparable>
+Comparable IndexedPriorityQueue<Comparable>::deleteMin() {
+    assert(!isEmpty());
+
+    const size_t h = pq[1];
+    remove(h);
+    return keys[h];
+}
+
+/**
+ * Add a new element x with handle h to the queue
+ */
+template <class Comparable>
+void IndexedPriorityQueue<Comparable>::insert(size_t h, const Comparable& x) {
+    assert(!contains(h));
+
+    keys[h] = x;
+    pq.push_back(h);
+    percolateUp(pq.size() - 1);
+
+    checkHeap();
+}
+
+/**
+ * Replace the element with handle h by a smaller or equal element x
+ */
+template <class Comparable>
+void IndexedPriorityQueue<Comparable>::decreaseKey(size_t h, const Comparable& x) {
+    assert(contains(h) && !(keys[h] < x));
+
+    keys[h] = x;
+    percolateUp(position[h]);
+
+    checkHeap();
+}
+
+/**
+ * Replace the element with handle h by x, or insert x if there is no element with handle h
+ */
+template <class Comparable>
+void IndexedPriorityQueue<Comparable>::update(size_t h, const Comparable& x) {
+    if (!contains(h)) {
+        insert(h, x);
+    } else if (x < keys[h]) {
+        decreaseKey(h, x);
+    } else {
+        keys[h] = x;
+        percolateDown(position[h]);
+
+        checkHeap();
+    }
+}
+
+/**
+ * Remove the element with handle h from the queue, if any
+ */
+template <class Comparable>
+void IndexedPriorityQueue<Comparable>::remove(size_t h) {
+    if (!contains(h)) {
+        return;
+    }
+
+    const size_t i = position[h];
+    const size_t last = pq.back();
+    pq.pop_back();
+    position[h] = 0;
+
+    if (i < pq.size()) {  // move the last handle into the hole and restore the heap order
+        place(i, last);
+        if (i > 1 && keys[last] < keys[pq[i / 2]]) {
+            percolateUp(i);
+        } else {
+            percolateDown(i);
+        }
+    }
+
+    checkHeap();
+}
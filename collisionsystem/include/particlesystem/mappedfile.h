@@ -0,0 +1,45 @@
+#pragma once
+
+#include <span>
+#include <cstddef>
+#include <filesystem>
+
+namespace particlesystem {
+
+/**
+ * A file mapped read-only into memory
+ * The contents are loaded by the operating system when accessed, nothing is copied
+ */
+class MappedFile {
+public:
+    /**
+     * Constructor to map the given file
+     * \throw std::runtime_error if the file cannot be opened or mapped
+     */
+    explicit MappedFile(const std::filesystem::path& file);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Disable copying
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Return the contents of the file
+     */
+    std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+private:
+    /**
+     * Unmap the file, if mapped
+     */
+    void unmap();
+
+    const std::byte* data_ = nullptr;  // start of the mapping, null for an empty file
+    std::size_t size_ = 0;             // size of the file in bytes
+};
+
+}  // namespace particlesystem
@@ -14,6 +14,14 @@ struct Color : glm::vec3 {
     using glm::vec3::vec3;
 };
 
+/**
+ * Kinetic energy and momentum of a particle or a collection of particles, or a change of them
+ */
+struct EnergyMomentum {
+    double energy = 0.0;
+    glm::dvec2 momentum = {0, 0};
+};
+
 /**
  *  The Particle class represents a particle moving in the unit box,
  *  with a given position, velocity, radius, and mass.
@@ -29,6 +37,15 @@ struct Particle {
      */
     void move(double dt) { r += v * dt; }
 
+    /**
+     * Move this particle in a straight line (based on its velocity) from the time
+     * its position was last updated to time t
+     */
+    void moveTo(double t) {
+        r += v * (t - time);
+        time = t;
+    }
+
     /**
      * Returns the number of collisions involving this particle with
      * vertical walls, horizontal walls, or other particles.
@@ -63,22 +80,26 @@ struct Particle {
      * Updates the velocities of this particle and the specified particle according
      * to the laws of elastic collision. Assumes that the particles are colliding
      * at this instant
+     * Return the change of the kinetic energy and momentum of both particles, which is only
+     * due to rounding errors
      */
-    void bounceOff(Particle& that);
+    EnergyMomentum bounceOff(Particle& that);
 
     /**
      * Updates the velocity of this particle upon collision with a vertical
      * wall (by reflecting the velocity in the x-direction)
      * Assumes that the particle is colliding with a vertical wall at this instant.
+     * Return the change of the kinetic energy (zero) and momentum of the particle
      */
-    void bounceOffVerticalWall();
+    EnergyMomentum bounceOffVerticalWall();
 
     /**
      * Updates the velocity of this particle upon collision with a horizontal
      * wall (by reflecting the velocity in the y-direction)
      * Assumes that the particle is colliding with a horizontal wall at this instant.
+     * Return the change of the kinetic energy (zero) and momentum of the particle
      */
-    void bounceOffHorizontalWall();
+    EnergyMomentum bounceOffHorizontalWall();
 
     /**
      * Returns the kinetic energy of this particle
@@ -87,12 +108,18 @@ struct Particle {
      */
     double kineticEnergy() const { return 0.5 * mass * glm::dot(v, v); }
 
+    /**
+     * Returns the momentum of this particle, m * v
+     */
+    glm::dvec2 momentum() const { return mass * v; }
+
     glm::dvec2 r = {0, 0};          // position
     glm::dvec2 v = {0, 0};          // velocity
     double radius = 0.01;           // radius
     double mass = 0.01;             // mass
     Color color = {1.0, 1.0, 1.0};  // color
     int count = 0;                  // number of collisions so far
+    double time = 0.0;              // simulation time at which r was last updated
 };
 
 /**
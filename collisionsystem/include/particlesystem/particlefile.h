@@ -0,0 +1,81 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include <particlesystem/particle.h>
+#include <particlesystem/mappedfile.h>
+
+namespace particlesystem {
+
+/**
+ * Binary particle file, memory-mapped and read without parsing
+ *
+ * Version 1 of the format is a header followed by one column per particle field:
+ *   char[4] magic "PSPF", uint32 version, uint64 number of particles n,
+ *   uint64 offset of each column in Field order,
+ *   padding up to the first column,
+ *   the columns: n float64 values each, starting at a multiple of 64 bytes
+ * Colors are stored in [0, 1]. Values are in the byte order of the machine that wrote the
+ * file (little-endian on all supported platforms).
+ * Use write_particle_file, or the convertparticles program, to create a file.
+ */
+class ParticleFile {
+public:
+    static constexpr std::uint32_t version = 1;
+
+    /**
+     * The fields of a particle, in column order
+     */
+    enum class Field { rx, ry, vx, vy, radius, mass, red, green, blue };
+    static constexpr std::size_t fieldCount = 9;
+
+    /**
+     * Return true if file starts like a binary particle file, of any version
+     */
+    static bool isParticleFile(const std::filesystem::path& file);
+
+    /**
+     * Constructor to map the given file
+     * \throw std::runtime_error if the file cannot be mapped, is not a binary particle file of
+     * this version or is shorter than its header claims
+     */
+    explicit ParticleFile(const std::filesystem::path& file);
+
+    /**
+     * Get the number of particles in the file
+     */
+    std::size_t size() const { return count_; }
+
+    /**
+     * Return the values of field f of all particles, a view of the mapped file
+     */
+    std::span<const double> column(Field f) const {
+        return {columns_[static_cast<std::size_t>(f)], count_};
+    }
+
+    /**
+     * Return particle i
+     */
+    Particle particle(std::size_t i) const;
+
+    /**
+     * Return all particles
+     */
+    std::vector<Particle> particles() const;
+
+private:
+    MappedFile file_;
+    std::size_t count_ = 0;
+    const double* columns_[fieldCount] = {};
+};
+
+/**
+ * Write the particles to a binary particle file
+ * \throw std::runtime_error if the file cannot be written
+ */
+void write_particle_file(const std::filesystem::path& file, std::span<const Particle> particles);
+
+}  // namespace particlesystem
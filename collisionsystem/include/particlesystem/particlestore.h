@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <cstddef>
+
+#include <particlesystem/alignedallocator.h>
+#include <particlesystem/particle.h>
+
+namespace particlesystem {
+
+/**
+ * Structure-of-arrays copy of the trajectories of a collection of particles
+ *
+ * Entry j describes the straight line followed by particle j: at time time[j] the particle is
+ * at (rx[j], ry[j]) and it moves with velocity (vx[j], vy[j]). The trajectory only changes when
+ * the particle changes velocity, so moving a particle does not require updating its entry.
+ * Each member is a separate cache-line aligned array, so that a block of consecutive entries
+ * can be loaded into SIMD registers.
+ */
+struct ParticleStore {
+    using Array = std::vector<double, CacheAlignedAllocator<double>>;
+
+    /**
+     * Constructor to create an empty store
+     */
+    ParticleStore() = default;
+
+    /**
+     * Constructor to create a store with the trajectories of the given particles
+     */
+    explicit ParticleStore(std::span<const Particle> particles);
+
+    /**
+     * Get the number of entries in the store
+     */
+    size_t size() const { return rx.size(); }
+
+    /**
+     * Remove all entries, the memory is kept for reuse
+     */
+    void clear();
+
+    /**
+     * Add the trajectory of particle p as the last entry
+     */
+    void push_back(const Particle& p);
+
+    /**
+     * Add a copy of entry i of store from as the last entry
+     */
+    void append(const ParticleStore& from, size_t i);
+
+    /**
+     * Replace entry i by the trajectory of particle p
+     * To be called whenever the velocity of the particle changes
+     */
+    void set(size_t i, const Particle& p);
+
+    /**
+     * Replace entry i by a copy of entry j of store from
+     */
+    void set(size_t i, const ParticleStore& from, size_t j);
+
+    Array rx, ry;    // position at time
+    Array vx, vy;    // velocity
+    Array radius;    // radius
+    Array time;      // simulation time of the position
+};
+
+/**
+ * Compute, for every entry j = first, first+1, ..., first+times.size()-1 of candidates, the
+ * amount of time for particle to collide with the particle of entry j, see
+ * Particle::timeToHit. The result is stored in times[j-first], which is
+ * std::numeric_limits<double>::infinity() if the particles will not collide.
+ * The position of particle must be up to date at time t, i.e. particle.time == t. Entries
+ * with the same velocity as particle, e.g. particle itself, never collide with it.
+ *
+ * Uses AVX-512 or AVX2 when the build targets them (__AVX512F__ or __AVX2__ defined, e.g.
+ * -march=native or /arch:AVX2), otherwise one candidate at a time. All variants give
+ * identical results, particlestore.cpp disables fused multiply-adds for this.
+ */
+void timeToHit(const Particle& particle, double t, const ParticleStore& candidates, size_t first,
+               std::span<double> times);
+
+}  // namespace particlesystem
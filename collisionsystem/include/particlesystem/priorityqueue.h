@@ -3,35 +3,89 @@
 #include <iostream>
 #include <vector>
 #include <cassert>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <iterator>
+#include <concepts>
 
 #include <algorithm>
 
-#define TEST_PRIORITY_QUEUE
+#include <particlesystem/alignedallocator.h>
+
+/*
+ * Heap validation is selected when building, by defining one of
+ *   - TEST_PRIORITY_QUEUE: isMinHeap() is checked after every operation, i.e. O(n) per
+ *     operation. Use for the checked build running the priority queue tests.
+ *   - PRIORITY_QUEUE_CHECK_INTERVAL=K: isMinHeap() is checked after every K-th operation
+ *     only, so a long simulation is still validated at an amortized O(n/K) cost.
+ * If neither is defined, e.g. in the release simulation build, no validation is compiled in.
+ * A failed validation throws std::logic_error.
+ */
+#if defined(TEST_PRIORITY_QUEUE) && defined(PRIORITY_QUEUE_CHECK_INTERVAL)
+#error "Define at most one of TEST_PRIORITY_QUEUE and PRIORITY_QUEUE_CHECK_INTERVAL"
+#endif
+
+/**
+ * Decide after which heap operations the heap is validated, according to the build options
+ */
+class HeapCheck {
+public:
+    /**
+     * Return true if the heap should be validated after the current operation
+     */
+    bool due() {
+#if defined(TEST_PRIORITY_QUEUE)
+        return true;
+#elif defined(PRIORITY_QUEUE_CHECK_INTERVAL)
+        return ++operations % PRIORITY_QUEUE_CHECK_INTERVAL == 0;
+#else
+        return false;
+#endif
+    }
+
+private:
+    std::size_t operations = 0;  // number of operations so far
+};
 
 /**
  * A heap based priority queue where the root is the smallest element -- min heap
+ *
+ * Each node has (at most) Arity children, Arity = 2 gives a binary heap.
+ * The first Arity-1 slots of the heap vector are not used, the root is in slot Arity-1 and
+ * the children of the node in slot i are the Arity slots starting at Arity*(i-Arity+2).
+ * Thus, the children of a node start at a slot that is a multiple of Arity and, since the
+ * vector storage is cache-line aligned, they share a single cache line whenever
+ * Arity * sizeof(Comparable) equals the cache line size (e.g. 8-ary heap of doubles).
+ *
+ * Tossed elements are added lazily. While the heap is unordered or empty, e.g. when the queue is
+ * bulk loaded, they are appended to the heap vector, which is ordered by a single heapify when
+ * the queue is next accessed. Once the heap is ordered, they are kept in a small side heap
+ * instead, which is merged into the heap in batches, so tossing a few elements between deleteMin
+ * calls never rebuilds the whole heap.
  */
-template <class Comparable>
+template <class Comparable, std::size_t Arity = 2>
 class PriorityQueue {
+    static_assert(Arity >= 2, "A heap node needs at least two children");
+
 public:
     /**
      * Constructor to create a queue with the given capacity
      */
     explicit PriorityQueue(int initCapacity = 100) : orderOK{true} {
-        pq.reserve(initCapacity + 1);
+        pq.reserve(initCapacity + root);
         makeEmpty();
         assert(isEmpty());
     }
 
     /**
      * Constructor to initialize a priority queue based on a given vector V
-     * Assumes V[0] is not used
+     * Assumes the first Arity-1 slots of V, i.e. V[0] for a binary heap, are not used
      */
-    explicit PriorityQueue(const std::vector<Comparable>& V) : pq{V} {
+    explicit PriorityQueue(const std::vector<Comparable>& V) : pq(V.begin(), V.end()) {
         heapify();
-#ifdef TEST_PRIORITY_QUEUE
-        assert(isMinHeap());
-#endif
+        checkHeap();
     }
 
     /**
@@ -39,7 +93,8 @@ public:
      */
     void makeEmpty() {
         pq.clear();
-        pq.push_back(Comparable{});
+        pq.resize(root);
+        side.clear();
     }
 
     /**
@@ -47,130 +102,203 @@ public:
      * Return true if the queue is empty, false otherwise
      */
     bool isEmpty() const {
-        return pq.size() == 1;  // slot zero is not used
+        return pq.size() == root && side.empty();  // slots before the root are not used
     }
 
     /**
      * Get the size of the queue, i.e. number of elements in the queue
      */
-    size_t size() const { return pq.size() - 1; }
+    size_t size() const { return pq.size() - root + side.size(); }
 
     /**
      * Get the smallest element in the queue
      */
-    Comparable findMin() {
+    const Comparable& findMin() {
         assert(isEmpty() == false);
-        return pq[1];
+        if (!orderOK) {
+            heapify();
+        }
+        return minInSide() ? side.front() : pq[root];
     }
 
     /**
      * Remove and return the smallest element in the queue
+     * The element is moved out of the queue, not copied
      */
     Comparable deleteMin();
 
+    /**
+     * Remove and return the smallest element in the queue, same as deleteMin
+     */
+    Comparable pop() { return deleteMin(); }
+
     /**
      * Add a new element x to the queue
      */
     void insert(const Comparable& x);
 
     /**
-     * Insert element x in the end of the queue, without preserving the heap property
+     * Add a new element x to the queue, x is moved into the queue
+     */
+    void push(Comparable&& x) { emplace(std::move(x)); }
+
+    /**
+     * Add a new element, constructed in place from args, to the queue
+     */
+    template <class... Args>
+    void emplace(Args&&... args);
+
+    /**
+     * Insert element x in the queue lazily, without ordering it yet (see the class comment)
      */
     void toss(const Comparable& x);
 
+    /**
+     * Move element x into the queue lazily, without ordering it yet (see the class comment)
+     */
+    void toss(Comparable&& x);
+
+    /**
+     * Insert the elements in [first, last) in the queue lazily, without ordering them yet (see
+     * the class comment). Use std::make_move_iterator to move the elements instead of copying
+     * them.
+     */
+    template <class InputIt>
+    void tossRange(InputIt first, InputIt last);
+
+    /**
+     * Replace the contents of the queue with the elements in [first, last)
+     * The heap is built with a single heapify, i.e. in linear time
+     */
+    template <class InputIt>
+    void assign(InputIt first, InputIt last);
+
 private:
-    std::vector<Comparable> pq;  // slot with index 0 not used
+    static constexpr size_t root = Arity - 1;  // slot of the root
+    static constexpr size_t sideCapacity = 64;  // elements in the side heap before merging
+
+    std::vector<Comparable, CacheAlignedAllocator<Comparable>> pq;  // slots before root not used
+    std::vector<Comparable> side;  // elements tossed while the heap was ordered, a min heap
     bool orderOK;  // flag to keep internal track of when the heap is ordered / not ordered
+    HeapCheck check;  // when to validate the heap
 
     // Auxiliary member functions
 
     /**
-     * Restore the heap-ordering property
+     * Slot of the first child of the node in slot i
      */
-    void heapify();
-
-    void percolateDown(size_t i);
+    static constexpr size_t firstChild(size_t i) { return Arity * (i - root + 1); }
 
     /**
-     * Test whether pq is a min heap
+     * Slot of the parent of the node in slot i, i must not be the root
      */
-    bool isMinHeap() const {
-        // TO BE IMPLEMENTED
+    static constexpr size_t parent(size_t i) { return (i - root - 1) / Arity + root; }
 
-        // if (isEmpty()) {
-        //     return false;
-        // }
+    /**
+     * Order of the side heap for the std heap algorithms, which build max heaps
+     */
+    static bool greater(const Comparable& a, const Comparable& b) { return b < a; }
 
-        // for (std::size_t i = 1; i < pq.size()/2; i++) {
+    /**
+     * Check whether the smallest element is in the side heap, the heap must be ordered
+     */
+    bool minInSide() const {
+        return !side.empty() && (pq.size() == root || side.front() < pq[root]);
+    }
 
-        //    if ((2 * i < pq.size()-1) && (pq[2 * i] <= pq[i])) {
-        //        return false;
-        //    }
-        //    if ((((2 * i) + 1) < pq.size()-1) && (pq[(2 * i) + 1] <= pq[i])) {
-        //        return false;
-        //    }
-        //}
+    /**
+     * Add element x lazily, see the class comment
+     */
+    template <class T>
+    void tossOne(T&& x);
 
-        // return true;
+    /**
+     * Move the elements of the side heap to the heap, the heap must be ordered
+     */
+    void mergeSide();
 
-        bool isMin = true;
-        size_t i = 1;  // Start from the root
+    /**
+     * Restore the heap-ordering property
+     */
+    void heapify();
 
-        int leftChild;
-        int rightChild;
+    void percolateDown(size_t i);
 
-        while (i <= pq.size()) {  // Only need to check up to the last parent node
+    void percolateUp(size_t i);
 
-            leftChild = 2 * i;       // Left child index
-            rightChild = 2 * i + 1;  // Right child index
+    /**
+     * Validate the heap, if required by the build options
+     * Tossed elements are not ordered, so the heap is only validated when orderOK is true
+     */
+    void checkHeap() {
+        if (orderOK && check.due() && !isMinHeap()) {
+            throw std::logic_error("PriorityQueue: heap order violated");
+        }
+    }
 
-            // Check if current node is greater than its left child
-            if (leftChild < pq.size() && pq[i] > pq[leftChild]) {
-                isMin = false;
-                break;
-            }
-            // Check if current node is greater than its right child
-            if (rightChild < pq.size() && pq[i] > pq[rightChild]) {
-                isMin = false;
-                break;
+    /**
+     * Test whether pq and the side heap are min heaps
+     */
+    bool isMinHeap() const {
+        // every node, except the root, must not be smaller than its parent
+        for (size_t i = root + 1; i < pq.size(); ++i) {
+            if (pq[i] < pq[parent(i)]) {
+                return false;
             }
-            i++;
         }
-
-        return isMin;
+        return std::ranges::is_heap(side, greater);
     }
 };
 
-template <class Comparable>
-void PriorityQueue<Comparable>::percolateDown(size_t i) {
-    Comparable temp = pq[i];  // temp is value at position i in pq
-    auto c = 2 * i;           // left child
+template <class Comparable, std::size_t Arity>
+void PriorityQueue<Comparable, Arity>::percolateDown(size_t i) {
+    Comparable temp = std::move(pq[i]);  // temp is value at position i in pq
+    auto c = firstChild(i);   // first child
 
     while (c < pq.size()) {  // test
-        if (c < pq.size() - 1) {
-            if (pq[c + 1] < pq[c])  // largest child?
-                c++;
+        // smallest child?
+        const auto last = std::min(c + Arity, pq.size());
+        for (auto sibling = c + 1; sibling < last; ++sibling) {
+            if (pq[sibling] < pq[c]) c = sibling;
         }
         // percolate down
         if (pq[c] < temp) {
-            pq[i] = pq[c];
+            pq[i] = std::move(pq[c]);
             i = c;
-            c = 2 * i;
+            c = firstChild(i);
         } else {
             break;
         }
     }
-    pq[i] = temp;
+    pq[i] = std::move(temp);
+}
+
+template <class Comparable, std::size_t Arity>
+void PriorityQueue<Comparable, Arity>::percolateUp(size_t i) {
+    Comparable temp = std::move(pq[i]);  // create a hole in slot i
+
+    //move hole upwards while temp < parent
+    for (; i > root && temp < pq[parent(i)]; i = parent(i)) {
+        pq[i] = std::move(pq[parent(i)]);
+    }
+
+    //insert temp at the empty slot
+    pq[i] = std::move(temp);
 }
 
 /**
  * Restore the heap property
  */
-template <class Comparable>
-void PriorityQueue<Comparable>::heapify() {
-    assert(pq.size() > 1);  // slot zero is not used
+template <class Comparable, std::size_t Arity>
+void PriorityQueue<Comparable, Arity>::heapify() {
+    assert(pq.size() >= root);  // slots before the root are not used
+
+    if (size() <= 1) {  // an empty queue or a single node is a heap
+        orderOK = true;
+        return;
+    }
 
-    for (size_t i = (pq.size() - 1) / 2; i >= 1; --i) {
+    for (size_t i = parent(pq.size() - 1); i >= root; --i) {
         percolateDown(i);
     }
     orderOK = true;
@@ -179,68 +307,152 @@ void PriorityQueue<Comparable>::heapify() {
 /**
  * Remove and return the smallest element in the queue
  */
-template <class Comparable>
-Comparable PriorityQueue<Comparable>::deleteMin() {
+template <class Comparable, std::size_t Arity>
+Comparable PriorityQueue<Comparable, Arity>::deleteMin() {
     assert(!isEmpty());
 
     if (!orderOK) {
         heapify();
     }
 
-    Comparable x = pq[1];
-    Comparable y = pq[pq.size() - 1];
+    if (minInSide()) {
+        std::ranges::pop_heap(side, greater);
+        Comparable x = std::move(side.back());
+        side.pop_back();
+
+        checkHeap();
+        return x;
+    }
+
+    Comparable x = std::move(pq[root]);
 
-    pq[1] = y;  // set last element in the heap as the new root
-    percolateDown(1);
+    if (pq.size() > root + 1) {
+        pq[root] = std::move(pq.back());  // set last element in the heap as the new root
+    }
     pq.pop_back();
+    if (pq.size() > root) {
+        percolateDown(root);
+    }
 
-#ifdef TEST_PRIORITY_QUEUE
-    assert(isMinHeap());
-#endif
+    checkHeap();
     return x;
 }
 
 /**
- * Insert element x on the last slot, without preserving the heap property
+ * Add element x lazily: on the last slot of an unordered or empty heap, without preserving the
+ * heap property, otherwise to the side heap, which is merged into the heap when full
  */
-template <class Comparable>
-void PriorityQueue<Comparable>::toss(const Comparable& x) {
-    orderOK = false;
-    pq.push_back(x);
+template <class Comparable, std::size_t Arity>
+template <class T>
+void PriorityQueue<Comparable, Arity>::tossOne(T&& x) {
+    if (!orderOK || pq.size() == root) {
+        orderOK = false;
+        pq.push_back(std::forward<T>(x));
+        return;
+    }
+
+    side.push_back(std::forward<T>(x));
+    std::ranges::push_heap(side, greater);
+    if (side.size() == sideCapacity) {
+        mergeSide();
+    }
+
+    checkHeap();
 }
 
 /**
- * Add a new element x to the queue
+ * Move the elements of the side heap to the heap
+ * Each element is percolated up from a new last slot, which costs O(1) on average for elements
+ * that belong near the bottom of the heap, unless the heap is so small that building it again
+ * is cheaper
  */
-template <class Comparable>
-void PriorityQueue<Comparable>::insert(const Comparable& x) {
-    // TO BE IMPLEMENTED
-   // toss(x);  // delete this line 
+template <class Comparable, std::size_t Arity>
+void PriorityQueue<Comparable, Arity>::mergeSide() {
+    const bool rebuild = pq.size() - root < Arity * side.size();
+    for (auto& x : side) {
+        pq.push_back(std::move(x));
+        if (!rebuild) {
+            percolateUp(pq.size() - 1);
+        }
+    }
+    side.clear();
 
-    //insert x at the end of the vector
-    pq.push_back(x); 
+    if (rebuild) {
+        heapify();
+    }
+}
 
-    //create a hole for x at the end of the vector
-    int empty_slot = pq.size()-1;
+/**
+ * Add element x lazily, see tossOne
+ */
+template <class Comparable, std::size_t Arity>
+void PriorityQueue<Comparable, Arity>::toss(const Comparable& x) {
+    tossOne(x);
+}
 
-    //move x to root
-    pq[0] = std::move(x); 
+/**
+ * Move element x into the queue lazily, see tossOne
+ */
+template <class Comparable, std::size_t Arity>
+void PriorityQueue<Comparable, Arity>::toss(Comparable&& x) {
+    tossOne(std::move(x));
+}
 
-    //move hole upwards while x < parent -> parent = i/2 for any index i 
-    for (; x < pq[empty_slot / 2]; empty_slot /= 2) { // division by 2 is cheap -> bit shifts 
+/**
+ * Add the elements in [first, last) lazily, see tossOne
+ * An unordered or empty heap is bulk loaded by appending them all to the last slots, as is an
+ * ordered heap when there are so many elements that building the heap again is cheaper
+ */
+template <class Comparable, std::size_t Arity>
+template <class InputIt>
+void PriorityQueue<Comparable, Arity>::tossRange(InputIt first, InputIt last) {
+    if (first == last) {
+        return;
+    }
 
-        //swap positions with parent while x is smaller than current parent node 
-        pq[empty_slot] = std::move(pq[empty_slot/2]); 
+    bool bulk = !orderOK || pq.size() == root;
+    if constexpr (std::forward_iterator<InputIt>) {
+        bulk = bulk || pq.size() - root < Arity * static_cast<size_t>(std::distance(first, last));
+    }
+    if (!bulk) {
+        for (; first != last; ++first) {
+            tossOne(*first);
+        }
+        return;
     }
+    orderOK = false;
+    pq.insert(pq.end(), first, last);
+}
 
-    //insert x at the empty slot, remember that copy of x was assigned to the root pq[0]
-    pq[empty_slot] = std::move(pq[0]); 
+/**
+ * Replace the contents of the queue with the elements in [first, last), then heapify once
+ */
+template <class Comparable, std::size_t Arity>
+template <class InputIt>
+void PriorityQueue<Comparable, Arity>::assign(InputIt first, InputIt last) {
+    makeEmpty();
+    tossRange(first, last);
+    heapify();
+    checkHeap();
+}
 
+/**
+ * Add a new element x to the queue
+ */
+template <class Comparable, std::size_t Arity>
+void PriorityQueue<Comparable, Arity>::insert(const Comparable& x) {
+    emplace(x);
+}
 
-#ifdef TEST_PRIORITY_QUEUE  // do not delete
-    /*if (!orderOK) {
-        heapify();
-    }*/
-    assert(isMinHeap());
-#endif
+/**
+ * Add a new element, constructed in place from args, to the queue
+ */
+template <class Comparable, std::size_t Arity>
+template <class... Args>
+void PriorityQueue<Comparable, Arity>::emplace(Args&&... args) {
+    //insert the new element at the end of the vector and move it upwards to its slot
+    pq.emplace_back(std::forward<Args>(args)...);
+    percolateUp(pq.size() - 1);
+
+    checkHeap();
 }
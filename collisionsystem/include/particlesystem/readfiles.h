@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+#include <filesystem>
+
+#include <particlesystem/particle.h>
+
+namespace particlesystem {
+
+/**
+ * Read particles for the simulation from file, either a binary particle file (see
+ * particlefile.h) or a text file
+ * The first line of a text file is the number of particles, followed by one particle per line:
+ * rx ry vx vy radius mass r g b
+ * Return an empty vector, if the file cannot be opened
+ * \throw std::runtime_error if the file holds fewer particles than it claims
+ */
+std::vector<Particle> read_particles(const std::filesystem::path& file);
+
+}  // namespace particlesystem
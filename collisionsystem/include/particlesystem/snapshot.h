@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+#include <particlesystem/particle.h>
+
+namespace particlesystem {
+
+/**
+ * Copy of the particles at a rendering event, for display
+ * Single precision is enough to draw, so each particle takes 16 bytes. Each member is an array
+ * with one entry per particle, in the order of the particles.
+ */
+struct Snapshot {
+    /**
+     * Replace the contents by the particles, at simulation time t
+     * The memory is kept, so reusing a snapshot for the same particles does not allocate
+     */
+    void assign(double t, std::span<const Particle> particles);
+
+    /**
+     * Get the number of particles
+     */
+    std::size_t size() const { return x.size(); }
+
+    double time = 0.0;                 // simulation time
+    std::vector<float> x, y;           // position
+    std::vector<float> radius;         // radius
+    std::vector<std::uint32_t> color;  // color as packed by glm::packUnorm4x8, opaque
+};
+
+}  // namespace particlesystem
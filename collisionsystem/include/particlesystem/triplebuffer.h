@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <particlesystem/alignedallocator.h>  // cacheLineSize
+
+/**
+ * A lock-free triple buffer: a single producer thread publishes values that a single consumer
+ * thread reads, without either of them ever waiting for the other
+ *
+ * Of the three slots, the producer owns one (the back slot) and the consumer owns one (the
+ * front slot). The third slot holds the latest published value. publish swaps the back slot
+ * with it and update swaps the front slot with it, if it is newer than the front slot. The
+ * consumer always sees the latest value published before update, values published in
+ * between are skipped. The slots are reused, so values holding memory (e.g. vectors) only
+ * allocate while growing.
+ */
+template <class T>
+class TripleBuffer {
+public:
+    /**
+     * Get the back slot, where the producer writes the next value
+     */
+    T& back() { return slots[backIndex].value; }
+
+    /**
+     * Make the value in the back slot available to the consumer, the producer continues in
+     * another slot
+     */
+    void publish() {
+        backIndex = latest.exchange(backIndex | fresh, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /**
+     * Make the latest published value the front slot, if there is a new one
+     * Return true if the front slot changed
+     */
+    bool update() {
+        if ((latest.load(std::memory_order_relaxed) & fresh) == 0) {
+            return false;
+        }
+        frontIndex = latest.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    /**
+     * Get the front slot, where the consumer reads the latest value it updated to
+     */
+    const T& front() const { return slots[frontIndex].value; }
+
+private:
+    static constexpr std::uint8_t indexMask = 0x3;
+    static constexpr std::uint8_t fresh = 0x4;  // set when the latest slot has not been read
+
+    // each slot on its own cache lines, as they are written by different threads
+    struct alignas(cacheLineSize) Slot {
+        T value{};
+    };
+
+    std::array<Slot, 3> slots;
+    std::uint8_t backIndex = 0;                                   // producer's slot
+    alignas(cacheLineSize) std::atomic<std::uint8_t> latest = 1;  // latest slot, fresh flag
+    alignas(cacheLineSize) std::uint8_t frontIndex = 2;           // consumer's slot
+};
@@ -9,6 +9,7 @@
 #include <string_view>
 #include <span>
 #include <particlesystem/particle.h>
+#include <particlesystem/snapshot.h>
 
 /// This namespace contains objects that are helper functions that support the rendering
 /// of general ui elements and graphics primitives.
@@ -49,6 +50,10 @@ public:
     // Draws particles on screen
     void drawParticles(std::span<particlesystem::Particle> particles);
 
+    // Draws the particles of a snapshot on screen, e.g. the latest one published by a
+    // simulation running on another thread
+    void drawParticles(const particlesystem::Snapshot& snapshot);
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl;
@@ -0,0 +1,204 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+
+#include <particlesystem/priorityqueue.h>
+#include <particlesystem/particle.h>
+#include <particlesystem/event.h>
+#include <particlesystem/collisionsystem.h>
+#include <particlesystem/readfiles.h>
+
+#include <fmt/format.h>
+
+using namespace particlesystem;
+
+/*
+ * Benchmark of the PriorityQueue heap layouts: binary (the original layout), 4-ary and 8-ary,
+ * and of the collision system event queue backends: binary heap and calendar queue
+ * Usage: benchmark [particles files...], e.g. benchmark billiards10.txt diffusion.txt brownian.txt
+ *
+ * Build without heap validation (neither TEST_PRIORITY_QUEUE nor PRIORITY_QUEUE_CHECK_INTERVAL
+ * defined), otherwise the timings include isMinHeap()
+ */
+
+/**
+ * test1PriorityQueue workload: toss all items, then deleteMin them all
+ * Return the number of queue operations
+ */
+template <std::size_t Arity>
+struct TossDeleteMin {
+    template <class Comparable>
+    std::size_t operator()(const std::vector<Comparable>& items) const {
+        PriorityQueue<Comparable, Arity> h(static_cast<int>(items.size()));
+        for (const auto& x : items) {
+            h.toss(x);
+        }
+        while (!h.isEmpty()) {
+            h.deleteMin();
+        }
+        return 2 * items.size();
+    }
+};
+
+/**
+ * test2PriorityQueue workload: insert all items, then deleteMin them all
+ * Return the number of queue operations
+ */
+template <std::size_t Arity>
+struct InsertDeleteMin {
+    template <class Comparable>
+    std::size_t operator()(const std::vector<Comparable>& items) const {
+        PriorityQueue<Comparable, Arity> h(static_cast<int>(items.size()));
+        for (const auto& x : items) {
+            h.insert(x);
+        }
+        while (!h.isEmpty()) {
+            h.deleteMin();
+        }
+        return 2 * items.size();
+    }
+};
+
+/**
+ * Items of the test1PriorityQueue/test2PriorityQueue workloads, in insertion order
+ */
+std::vector<int> testItems();
+
+/**
+ * All events predicted for the particles at time zero, in prediction order
+ */
+std::vector<Event> eventTrace(std::vector<Particle>& particles);
+
+/**
+ * Run the workload for the binary, 4-ary and 8-ary heaps and print the throughputs
+ */
+template <template <std::size_t> class Workload, class Comparable>
+void compareLayouts(const std::string& name, const std::vector<Comparable>& items);
+
+/**
+ * Simulate the particles with each event queue backend and print the running times
+ */
+void compareBackends(const std::string& name, const std::vector<Particle>& particles);
+
+int main(int argc, char* argv[]) {
+    fmt::print("{:<40} {:>6} {:>10} {:>14}\n", "workload", "arity", "time (ms)", "Mops/s");
+
+    const auto items = testItems();
+    compareLayouts<TossDeleteMin>("test1: toss, deleteMin", items);
+    compareLayouts<InsertDeleteMin>("test2: insert, deleteMin", items);
+
+    for (int i = 1; i < argc; ++i) {
+        auto particles = read_particles(argv[i]);
+        if (particles.empty()) {
+            fmt::print("No particles in {}\n", argv[i]);
+            continue;
+        }
+
+        const auto events = eventTrace(particles);
+        const auto name = std::filesystem::path{argv[i]}.filename().string();
+        compareLayouts<TossDeleteMin>(fmt::format("{}: toss, deleteMin", name), events);
+        compareLayouts<InsertDeleteMin>(fmt::format("{}: insert, deleteMin", name), events);
+        compareBackends(name, particles);
+    }
+}
+
+/**
+ * Items of the test1PriorityQueue/test2PriorityQueue workloads, in insertion order
+ */
+std::vector<int> testItems() {
+    constexpr int minItem = 10000;
+    constexpr int maxItem = 99999;
+
+    std::vector<int> items;
+    for (int i = 37; i != 0; i = (i + 37) % maxItem) {
+        if (i >= minItem) {
+            items.push_back(i);
+        }
+    }
+    return items;
+}
+
+/**
+ * All events predicted for the particles at time zero, in prediction order
+ * Each pair of particles is predicted from both particles, as the collision system does
+ * during the simulation
+ */
+std::vector<Event> eventTrace(std::vector<Particle>& particles) {
+    std::vector<Event> events;
+
+    auto add = [&](double time, EventType type, std::uint32_t a, std::uint32_t b) {
+        if (time < std::numeric_limits<double>::infinity()) {
+            events.emplace_back(time, type, a, b, particles);
+        }
+    };
+
+    for (std::uint32_t i = 0; i < particles.size(); ++i) {
+        for (std::uint32_t j = 0; j < particles.size(); ++j) {
+            add(particles[i].timeToHit(particles[j]), EventType::Collision, i, j);
+        }
+        add(particles[i].timeToHitVerticalWall(), EventType::VerticalWall, i, Event::none);
+        add(particles[i].timeToHitHorizontalWall(), EventType::HorizontalWall, i, Event::none);
+    }
+    return events;
+}
+
+/**
+ * Time the workload for one heap layout and print the result
+ */
+template <template <std::size_t> class Workload, std::size_t Arity, class Comparable>
+void timeLayout(const std::string& name, const std::vector<Comparable>& items) {
+    constexpr int repetitions = 5;
+
+    double best = std::numeric_limits<double>::infinity();
+    std::size_t operations = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        operations = Workload<Arity>{}(items);
+        const auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+
+    fmt::print("{:<40} {:>6} {:>10.2f} {:>14.2f}\n", name, Arity, best * 1e3,
+               operations / best * 1e-6);
+}
+
+/**
+ * Run the workload for the binary, 4-ary and 8-ary heaps and print the throughputs
+ */
+template <template <std::size_t> class Workload, class Comparable>
+void compareLayouts(const std::string& name, const std::vector<Comparable>& items) {
+    timeLayout<Workload, 2>(name, items);
+    timeLayout<Workload, 4>(name, items);
+    timeLayout<Workload, 8>(name, items);
+}
+
+/**
+ * Simulate the particles with each event queue backend and print the running times
+ */
+void compareBackends(const std::string& name, const std::vector<Particle>& particles) {
+    constexpr double simulationTime = 100.0;
+
+    auto replay = [&](CollisionSystem::QueueBackend queue, std::string_view backend) {
+        CollisionSystem::Options options;
+        options.neighborhood = CollisionSystem::Neighborhood::CellList;
+        options.queue = queue;
+        CollisionSystem system{particles, options};
+        system.renderCallback = [](std::span<Particle>) {};
+        system.abortCallback = []() { return false; };
+
+        const auto start = std::chrono::steady_clock::now();
+        system.simulate(simulationTime, 1.0 / simulationTime);  // render only at time zero
+        const auto stop = std::chrono::steady_clock::now();
+
+        fmt::print("{:<40} {:>6} {:>10.2f}\n", fmt::format("{}: simulate, {}", name, backend),
+                   "-", std::chrono::duration<double>(stop - start).count() * 1e3);
+    };
+
+    replay(CollisionSystem::QueueBackend::BinaryHeap, "binary heap");
+    replay(CollisionSystem::QueueBackend::Calendar, "calendar queue");
+}
@@ -0,0 +1,38 @@
+#include <vector>
+#include <exception>
+#include <filesystem>
+
+#include <particlesystem/particle.h>
+#include <particlesystem/readfiles.h>
+#include <particlesystem/particlefile.h>
+
+#include <fmt/format.h>
+
+using namespace particlesystem;
+
+/*
+ * Convert a particles text file to a binary particle file (see particlefile.h), which the
+ * simulation loads without parsing
+ * Usage: convertparticles particles-file binary-file, e.g. convertparticles brownian.txt brownian.bin
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fmt::print("Usage: convertparticles particles-file binary-file\n");
+        return 1;
+    }
+
+    try {
+        const auto particles = read_particles(argv[1]);
+        if (particles.empty()) {
+            fmt::print("No particles in {}\n", argv[1]);
+            return 1;
+        }
+
+        write_particle_file(argv[2], particles);
+        fmt::print("Wrote {} particles to {}\n", particles.size(), argv[2]);
+    } catch (const std::exception& e) {
+        fmt::print("Error: {}\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -5,10 +5,23 @@
 #include <random>
 #include <optional>
 #include <filesystem>
+#include <span>
+#include <string_view>
+#include <stdexcept>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <cmath>
 
 #include <particlesystem/priorityqueue.h>
+#include <particlesystem/calendarqueue.h>
 #include <particlesystem/particle.h>
 #include <particlesystem/collisionsystem.h>
+#include <particlesystem/readfiles.h>
+#include <particlesystem/eventlog.h>
+#include <particlesystem/checkpoint.h>
+#include <particlesystem/snapshot.h>
+#include <particlesystem/triplebuffer.h>
 
 #include <rendering/window.h>
 
@@ -27,57 +40,50 @@ void test1PriorityQueue();
 void test2PriorityQueue();
 
 /**
- * Read particles for the simulation from file
+ * To test insert, deleteMin and the bucket width of the calendar queue
  */
-std::vector<Particle> read_particles(const std::filesystem::path& file);
+void test3CalendarQueue();
 
 /**
  * To run the simulation
  */
 void runSimulation();
 
-int main() {
+/**
+ * To run the simulation without rendering, logging all events to a binary file
+ * args: particles or checkpoint file, simulation time, log file and, optionally, snapshots
+ * per time unit followed by a checkpoint file and the checkpoint interval
+ * Return the exit code of the program
+ */
+int runHeadless(std::span<char*> args);
+
+/*
+ * The program is built in one of three configurations (see priorityqueue.h):
+ *   - checked build, TEST_PRIORITY_QUEUE defined: runs the priority queue tests, validating
+ *     the heap after every operation
+ *   - release build, no validation defined: runs the simulation
+ *   - sampled build, PRIORITY_QUEUE_CHECK_INTERVAL=K defined: runs the simulation and
+ *     validates the event queue every K-th operation
+ *
+ * Usage: lab3, or for a run without window (e.g. on a server without display)
+ *        lab3 --headless particles-file simulation-time log-file
+ *             [snapshots-per-time-unit [checkpoint-file checkpoint-interval]]
+ *        where particles-file can be a checkpoint file, to resume a simulation
+ */
+int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[]) {
 #ifdef TEST_PRIORITY_QUEUE
     test1PriorityQueue();  // test toss, deleteMin, heapify, isMinHeap
     test2PriorityQueue();  // test insert, deleteMin, isMinHeap
+    test3CalendarQueue();  // test the calendar queue
 #endif
 
 #ifndef TEST_PRIORITY_QUEUE
+    if (argc > 1 && std::string_view{argv[1]} == "--headless") {
+        return runHeadless(std::span{argv + 2, argv + argc});
+    }
     runSimulation();
 #endif
-}
-
-/**
- * Read particles for the simulation from file
- */
-std::vector<Particle> read_particles(const std::filesystem::path& file) {
-    std::ifstream is(file);
-    if (!is) {
-        return {};
-    }
-
-    int n_particles;
-    is >> n_particles;  // read number of particles
-
-    std::vector<Particle> particles;
-    particles.reserve(n_particles);
-
-    double rx, ry;
-    double vx, vy;
-    double radius;
-    double mass;
-    float r, g, b;
-    for (int i = 0; i < n_particles; ++i) {
-        is >> rx >> ry >> vx >> vy;
-        is >> radius >> mass;
-        is >> r >> g >> b;
-        particles.push_back(Particle{.r = {rx, ry},
-                                     .v = {vx, vy},
-                                     .radius = radius,
-                                     .mass = mass,
-                                     .color = {r / 255.0f, g / 255.0f, b / 255.0f}});
-    }
-    return particles;
+    return 0;
 }
 
 void runSimulation() {
@@ -99,17 +105,99 @@ void runSimulation() {
     CollisionSystem system{std::move(theParticles)};
 
     // Some initializations for rendering
-    rendering::Window window(850, 850, rendering::Window::UseVSync::No);
+    rendering::Window window(850, 850, rendering::Window::UseVSync::Yes);
+
+    // The simulation runs on its own thread and publishes a snapshot at every rendering event,
+    // while this thread draws the latest snapshot. Neither waits for the other, so the
+    // simulation never stalls on the GPU or the display.
+    TripleBuffer<Snapshot> snapshots;
+    std::atomic<bool> finished = false;  // the simulation is over
     system.renderCallback = [&](std::span<Particle> particles) {
+        snapshots.back().assign(system.statistics().simulationTime, particles);
+        snapshots.publish();
+    };
+
+    fmt::print("Simulations starts ...\n");
+    std::exception_ptr error;
+    // stop is requested when the window is closed, or by ~jthread if rendering throws
+    std::jthread simulation{[&](std::stop_token stop) {
+        system.abortCallback = [stop]() { return stop.stop_requested(); };
+        try {
+            system.simulate(10000, 10);  // simulate
+        } catch (...) {
+            error = std::current_exception();
+        }
+        finished = true;
+    }};
+
+    while (!finished && !window.shouldClose()) {
+        snapshots.update();
         window.beginFrame();
         window.clear({0, 0, 0, 1});
-        window.drawParticles(particles);
+        window.drawParticles(snapshots.front());
         window.endFrame();
-    };
-    system.abortCallback = [&]() { return window.shouldClose(); };
+    }
 
-    fmt::print("Simulations starts ...\n");
-    system.simulate(10000, 10);  // simulate
+    simulation.request_stop();
+    simulation.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+int runHeadless(std::span<char*> args) {
+    if (args.size() < 3 || args.size() == 5 || args.size() > 6) {
+        fmt::print("Usage: lab3 --headless particles-file simulation-time log-file "
+                   "[snapshots-per-time-unit [checkpoint-file checkpoint-interval]]\n");
+        return 1;
+    }
+
+    try {
+        const std::filesystem::path particlesFile = args[0];
+        const double simulationTime = std::stod(args[1]);
+        const std::filesystem::path logFile = args[2];
+        const double snapshotFrequency = args.size() >= 4 ? std::stod(args[3]) : 1.0;
+
+        CollisionSystem::Options options;
+        if (args.size() == 6) {
+            options.checkpointFile = args[4];
+            options.checkpointInterval = std::stod(args[5]);
+        }
+
+        // resume from a checkpoint, or start from the particles file
+        Checkpoint start;
+        if (is_checkpoint_file(particlesFile)) {
+            start = read_checkpoint(particlesFile);
+            fmt::print("Resuming at simulation time {}\n", start.time);
+        } else {
+            start.particles = read_particles(particlesFile);
+        }
+        if (std::size(start.particles) == 0) {
+            fmt::print("No particles\n");
+            return 1;
+        }
+
+        EventLog log{logFile, start.particles.size()};
+        CollisionSystem system{std::move(start), options};
+
+        // every rendering event writes a snapshot, at the time of the event
+        double renderTime = system.time();
+        system.eventCallback = [&](const CollisionSystem::EventRecord& e) {
+            log.write(e);
+            if (e.type == EventType::Render) renderTime = e.time;
+        };
+        system.renderCallback = [&](std::span<Particle> particles) {
+            log.writeSnapshot(renderTime, particles);
+        };
+
+        fmt::print("Simulations starts ...\n");
+        system.simulate(simulationTime, snapshotFrequency);
+        fmt::print("{}\n", system.statistics().toJson());
+    } catch (const std::exception& e) {
+        fmt::print("Error: {}\n", e.what());
+        return 1;
+    }
+    return 0;
 }
 
 /**
@@ -169,3 +257,49 @@ void test2PriorityQueue() {
     }
     fmt::print("Successful test...\n");
 }
+
+/**
+ * To test insert, deleteMin and the bucket width of the calendar queue
+ */
+void test3CalendarQueue() {
+    constexpr int minItem = 10000;
+    constexpr int maxItem = 99999;
+    CalendarQueue<int> h;
+
+    fmt::print("Test3: calendar queue insert, deleteMin\n");
+
+    for (int i = 37; i != 0; i = (i + 37) % maxItem) {
+        if (i >= minItem) {
+            h.insert(i);
+        }
+    }
+
+    for (int i = minItem; i < maxItem; ++i) {
+        int x = h.deleteMin();
+        if (x != i) {
+            fmt::print("Oops! Error after delete of {}\n", i);
+        }
+    }
+
+    // many equal priorities, e.g. events of particles on a lattice, and a few tiny gaps must not
+    // shrink the bucket width so much that the days of later priorities overflow
+    CalendarQueue<double> t;
+    for (int i = 0; i < 40; ++i) {
+        t.insert(0.01);
+    }
+    t.insert(std::nextafter(0.01, 1.0));
+    t.insert(10000.0);
+
+    double last = 0.0;
+    while (!t.isEmpty()) {
+        const double x = t.deleteMin();
+        if (x < last) {
+            fmt::print("Oops! Error after delete of {}\n", x);
+        }
+        last = x;
+    }
+    if (last != 10000.0) {
+        fmt::print("Oops! Error, last deleted {} instead of 10000\n", last);
+    }
+    fmt::print("Successful test...\n");
+}
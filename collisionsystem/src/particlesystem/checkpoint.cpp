@@ -0,0 +1,145 @@
+#include <particlesystem/checkpoint.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <fmt/format.h>
+
+namespace particlesystem {
+
+namespace {
+
+constexpr char magic[4] = {'P', 'S', 'C', 'K'};
+
+// bytes per particle in a checkpoint file
+constexpr std::uint64_t particleSize =
+    6 * sizeof(double) + 3 * sizeof(float) + sizeof(std::int32_t);
+
+/**
+ * Help function to write the bytes of x to os
+ */
+template <class T>
+void put(std::ostream& os, const T& x) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    os.write(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+/**
+ * Help function to read x from the bytes of is
+ */
+template <class T>
+void get(std::istream& is, T& x) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    is.read(reinterpret_cast<char*>(&x), sizeof(x));
+}
+
+}  // namespace
+
+/**
+ * Return true if file starts like a checkpoint file
+ */
+bool is_checkpoint_file(const std::filesystem::path& file) {
+    std::ifstream is(file, std::ios::binary);
+    char start[sizeof(magic)] = {};
+    return is.read(start, sizeof(start)) && std::memcmp(start, magic, sizeof(magic)) == 0;
+}
+
+/**
+ * Write the state of the particles at time to a checkpoint file
+ */
+void write_checkpoint(const std::filesystem::path& file, double time,
+                      std::span<const Particle> particles) {
+    auto temporary = file;
+    temporary += ".tmp";
+
+    {
+        std::ofstream os(temporary, std::ios::binary | std::ios::trunc);
+        os.write(magic, sizeof(magic));
+        put(os, Checkpoint::version);
+        put(os, static_cast<std::uint64_t>(particles.size()));
+        put(os, time);
+        for (const auto& p : particles) {
+            put(os, p.r.x);
+            put(os, p.r.y);
+            put(os, p.v.x);
+            put(os, p.v.y);
+            put(os, p.radius);
+            put(os, p.mass);
+            put(os, static_cast<float>(p.color.r));
+            put(os, static_cast<float>(p.color.g));
+            put(os, static_cast<float>(p.color.b));
+            put(os, static_cast<std::int32_t>(p.count));
+        }
+
+        if (!os.flush()) {
+            throw std::runtime_error(fmt::format("Unable to write checkpoint {}", file.string()));
+        }
+    }
+
+    std::filesystem::rename(temporary, file);  // replaces the previous checkpoint
+}
+
+/**
+ * Read a checkpoint file
+ */
+Checkpoint read_checkpoint(const std::filesystem::path& file) {
+    auto fail = [&](std::string_view reason) {
+        throw std::runtime_error(fmt::format("Invalid checkpoint {}: {}", file.string(), reason));
+    };
+
+    std::ifstream is(file, std::ios::binary);
+    if (!is) {
+        fail("cannot be opened");
+    }
+
+    char start[sizeof(magic)] = {};
+    std::uint32_t version = 0;
+    std::uint64_t n = 0;
+    Checkpoint checkpoint;
+    is.read(start, sizeof(start));
+    get(is, version);
+    get(is, n);
+    get(is, checkpoint.time);
+    if (!is || std::memcmp(start, magic, sizeof(magic)) != 0) {
+        fail("not a checkpoint file");
+    }
+    if (version != Checkpoint::version) {
+        fail(fmt::format("version {}, expected {}", version, Checkpoint::version));
+    }
+
+    // the file must hold n particles
+    std::error_code ec;
+    const std::uintmax_t size = std::filesystem::file_size(file, ec);
+    const std::uintmax_t header = sizeof(magic) + sizeof(version) + sizeof(n) + sizeof(double);
+    if (ec || size < header || (size - header) / particleSize != n ||
+        (size - header) % particleSize != 0) {
+        fail(fmt::format("does not hold {} particles", n));
+    }
+
+    checkpoint.particles.resize(static_cast<size_t>(n));
+    for (auto& p : checkpoint.particles) {
+        float red, green, blue;
+        std::int32_t count;
+        get(is, p.r.x);
+        get(is, p.r.y);
+        get(is, p.v.x);
+        get(is, p.v.y);
+        get(is, p.radius);
+        get(is, p.mass);
+        get(is, red);
+        get(is, green);
+        get(is, blue);
+        get(is, count);
+        p.color = {red, green, blue};
+        p.count = count;
+        p.time = checkpoint.time;
+    }
+    if (!is) {
+        fail("truncated");
+    }
+
+    return checkpoint;
+}
+
+}  // namespace particlesystem
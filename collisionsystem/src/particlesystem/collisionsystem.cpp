@@ -1,118 +1,1403 @@
-#include <particlesystem/collisionsystem.h>
-
-#include <cassert>
-#include <span>
-#include <numeric>
-#include <fmt/format.h>
-
-namespace particlesystem {
-
-namespace {
-
-/**
- * Help function to add a new event between particleA and particleB to the queue
- * The event's time must be smaller than simulationTime to be added to the queue
- */
-void addEvent(double time, Particle* particleA, Particle* particleB, PriorityQueue<Event>& queue,
-              double simulationTime) {
-    if (time < simulationTime) {
-        // queue.insert(Event{time, particleA, particleB});
-        queue.toss(Event{time, particleA, particleB});
-    }
-}
-
-}  // namespace
-
-/**
- * Constructor to create a system with the specified collection of particles
- * The individual particles will be mutated during the simulation
- */
-CollisionSystem::CollisionSystem(std::vector<Particle> particles)
-    : particles_{std::move(particles)} {}
-
-/**
- * Update priority queue with all new events for particle
- */
-void CollisionSystem::predict(PriorityQueue<Event>& queue, Particle& particle, double currentTime,
-                              double simulationTime) {
-    // particle-particle collisions
-    for (auto& p : particles_) {
-        const double dt = particle.timeToHit(p);
-        addEvent(currentTime + dt, &particle, &p, queue, simulationTime);
-    }
-
-    // particle-wall collisions
-    const double dtX = particle.timeToHitVerticalWall();
-    addEvent(currentTime + dtX, &particle, nullptr, queue, simulationTime);
-
-    const double dtY = particle.timeToHitHorizontalWall();
-    addEvent(currentTime + dtY, nullptr, &particle, queue, simulationTime);
-}
-
-void CollisionSystem::simulate(double simulationTime, double drawFrequenzy) {
-    PriorityQueue<Event> queue;  // the priority queue
-    double currentTime = 0.0;    // initialize simulation clock time
-
-    // add the first rendering event to the queue
-    addEvent(0.0, nullptr, nullptr, queue, simulationTime);
-
-    // add all possible collisions of particle with other particles and walls to the queue
-    for (auto& particle : particles_) {
-        predict(queue, particle, currentTime, simulationTime);
-    }
-
-    // the main event-driven simulation loop
-    while (!queue.isEmpty()) {
-        // get impending event, discard if invalidated
-        const Event e = queue.deleteMin();
-        if (!e.isValid()) {
-            continue;
-        }
-
-        Particle* particleA = e.particleA;  // pointer to particle A
-        Particle* particleB = e.particleB;  // pointer to particle B
-
-        // update particles positions
-        for (auto& p : particles_) {
-            p.move(e.time - currentTime);
-        }
-        currentTime = e.time;  // update simulation clock
-
-        // process event: update velocity, if needed
-        if (particleA != nullptr && particleB != nullptr) {
-            particleA->bounceOff(*particleB);  // particle-particle collision
-            predict(queue, *particleA, currentTime, simulationTime);
-            predict(queue, *particleB, currentTime, simulationTime);
-        } else if (particleA != nullptr && particleB == nullptr) {
-            particleA->bounceOffVerticalWall();  // particle-horizontal wall collision
-            predict(queue, *particleA, currentTime, simulationTime);
-        } else if (particleA == nullptr && particleB != nullptr) {
-            particleB->bounceOffHorizontalWall();  // particle-vertical wall collision
-            predict(queue, *particleB, currentTime, simulationTime);
-        } else if (particleA == nullptr && particleB == nullptr) {
-            renderCallback(particles_);
-
-            // add another redraw event to the queue
-            addEvent(currentTime + 1.0 / drawFrequenzy, nullptr, nullptr, queue, simulationTime);
-
-            fmt::print("Simulation Time: {:8.3f}, Queue Size: {:10}\n", currentTime, queue.size());
-
-            if (abortCallback()) break; // in case user closes the simulation window
-        }
-    }
-}
-
- /**
- * Return a vector with all system particles
- */
-const std::vector<Particle>& CollisionSystem::particles() const { return particles_; }
-
-/**
- * Returns the kinetic energy of the particles system
- */
-double CollisionSystem::kineticEnergy() const {
-    return std::transform_reduce(particles_.begin(), particles_.end(), 0.0, std::plus<>{},
-                                 [](const auto& p) { return p.kineticEnergy(); });
-}
-
-}  // namespace particlesystem
+#include <particlesystem/collisionsystem.h>
+#include <particlesystem/calendarqueue.h>
+
+#include <cassert>
+#include <span>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <barrier>
+#include <optional>
+#include <tuple>
+#include <limits>
+#include <chrono>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace particlesystem {
+
+namespace {
+
+constexpr double infinity = std::numeric_limits<double>::infinity();
+
+/**
+ * Smallest number of cell columns per strip with Scheduling::Parallel, so that most columns
+ * are interior to their strip
+ */
+constexpr int minStripColumns = 8;
+
+/**
+ * Help function to add a new event of the given type between particles a and b to events,
+ * see Event. The event's time must be smaller than simulationTime to be added
+ */
+void addEvent(double time, EventType type, size_t a, size_t b,
+              std::span<const Particle> particles, std::vector<Event>& events,
+              double simulationTime) {
+    if (time < simulationTime) {
+        events.emplace_back(time, type, static_cast<std::uint32_t>(a),
+                            static_cast<std::uint32_t>(b), particles);
+    }
+}
+
+/**
+ * Priority of an event in a CalendarQueue: the time of the event
+ */
+struct EventTime {
+    double operator()(const Event& e) const { return e.getTime(); }
+};
+
+/**
+ * Help class to add the wall-clock time spent in a scope to a number of seconds
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(double& seconds)
+        : seconds_{seconds}, start_{std::chrono::steady_clock::now()} {}
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    double& seconds_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Help function to insert all events in the queue, without preserving the heap property
+ */
+template <class Queue>
+void tossAll(std::vector<Event>& events, Queue& queue) {
+    queue.tossRange(events.begin(), events.end());
+    events.clear();
+}
+
+/**
+ * Help function to compute the time until a particle at position x, moving with speed v,
+ * leaves cell number c (of width w) along one axis. The number of the cell entered is
+ * stored in next. Return infinity, if the particle stays in the cell (along this axis).
+ */
+double timeToLeaveCell(double x, double v, int c, int gridSize, double w, int& next) {
+    if (v > 0 && c < gridSize - 1) {
+        next = c + 1;
+        return std::max((next * w - x) / v, 0.0);
+    } else if (v < 0 && c > 0) {
+        next = c - 1;
+        return std::max((c * w - x) / v, 0.0);
+    }
+    next = c;
+    return std::numeric_limits<double>::infinity();
+}
+
+/**
+ * Help function to get particle p on entry i of store, i.e. as it was when its velocity last
+ * changed
+ */
+Particle onTrajectory(Particle p, const ParticleStore& store, size_t i) {
+    p.r = {store.rx[i], store.ry[i]};
+    p.v = {store.vx[i], store.vy[i]};
+    p.time = store.time[i];
+    return p;
+}
+
+}  // namespace
+
+/**
+ * Constructor to create a system with the specified collection of particles
+ * The individual particles will be mutated during the simulation
+ */
+CollisionSystem::CollisionSystem(std::vector<Particle> particles)
+    : CollisionSystem(std::move(particles), Options{}) {}
+
+/**
+ * Constructor to create a system with the specified collection of particles and options
+ * The individual particles will be mutated during the simulation
+ */
+CollisionSystem::CollisionSystem(std::vector<Particle> particles, Options options)
+    : particles_{std::move(particles)}
+    , options_{options}
+    , store_{particles_}
+    , conservation_{particles_} {
+    if (options_.neighborhood != Neighborhood::CellList || particles_.empty()) {
+        return;
+    }
+
+    // cells must be at least as wide as the largest particle diameter, so that particles in
+    // non-neighboring cells cannot collide, and there is no point in many more cells than
+    // particles
+    const auto largest = std::ranges::max(particles_, {}, &Particle::radius).radius;
+    const double maxCells = largest > 0.0 ? std::floor(0.5 / largest) : particles_.size();
+    const double fewCells = std::ceil(std::sqrt(static_cast<double>(particles_.size())));
+    gridSize_ = std::max(static_cast<int>(std::min(maxCells, fewCells)), 1);
+
+    cells_.resize(static_cast<size_t>(gridSize_) * gridSize_);
+    cellOf_.reserve(particles_.size());
+    for (auto& p : particles_) {
+        const int cell = cellIndex(p.r);
+        cellOf_.push_back(cell);
+        cells_[cell].push_back(&p);
+    }
+}
+
+/**
+ * Constructor to resume a simulation from a checkpoint
+ */
+CollisionSystem::CollisionSystem(Checkpoint checkpoint, Options options)
+    : CollisionSystem(std::move(checkpoint.particles), options) {
+    clock_ = checkpoint.time;
+}
+
+/**
+ * Return the index of the grid cell that contains position r
+ */
+int CollisionSystem::cellIndex(const glm::dvec2& r) const {
+    const int cx = std::clamp(static_cast<int>(r.x * gridSize_), 0, gridSize_ - 1);
+    const int cy = std::clamp(static_cast<int>(r.y * gridSize_), 0, gridSize_ - 1);
+    return cy * gridSize_ + cx;
+}
+
+/**
+ * Add to events all new events for particle
+ */
+void CollisionSystem::predict(std::vector<Event>& events, Particle& particle, double currentTime,
+                              double simulationTime) {
+    ScopedTimer timer{stats_.predictSeconds};
+    predict(events, candidates_, particle, currentTime, simulationTime, 0);
+}
+
+/**
+ * Add to events all new events for particle, using the given candidates buffer
+ * Only collisions with the particles with index first, first+1, ... are predicted
+ */
+void CollisionSystem::predict(std::vector<Event>& events, Candidates& candidates,
+                              Particle& particle, double currentTime, double simulationTime,
+                              size_t first) {
+    const size_t i = indexOf(&particle);
+
+    // particle-particle collisions, all particles are candidates
+    if (gridSize_ == 0) {
+        candidates.times.resize(store_.size() - std::min(first, store_.size()));
+        timeToHit(particle, currentTime, store_, first, candidates.times);
+        for (size_t k = 0; k < candidates.times.size(); ++k) {
+            addEvent(currentTime + candidates.times[k], EventType::Collision, i, first + k,
+                     particles_, events, simulationTime);
+        }
+    } else {
+        const int cell = cellOf_[i];
+        const int cx = cell % gridSize_;
+        const int cy = cell / gridSize_;
+        for (int y = cy - 1; y <= cy + 1; ++y) {
+            for (int x = cx - 1; x <= cx + 1; ++x) {
+                gatherCell(candidates, x, y, first);
+            }
+        }
+        predictCandidates(events, candidates, particle, currentTime, simulationTime);
+        predictCellCrossing(events, particle, currentTime, simulationTime);
+    }
+
+    // particle-wall collisions
+    const double dtX = particle.timeToHitVerticalWall();
+    addEvent(currentTime + dtX, EventType::VerticalWall, i, Event::none, particles_, events,
+             simulationTime);
+
+    const double dtY = particle.timeToHitHorizontalWall();
+    addEvent(currentTime + dtY, EventType::HorizontalWall, i, Event::none, particles_, events,
+             simulationTime);
+}
+
+/**
+ * Add to events all collisions of particle with the candidates gathered by gatherCell
+ * The candidates are cleared afterwards
+ */
+void CollisionSystem::predictCandidates(std::vector<Event>& events, Candidates& candidates,
+                                        Particle& particle, double currentTime,
+                                        double simulationTime) {
+    candidates.times.resize(candidates.store.size());
+    timeToHit(particle, currentTime, candidates.store, 0, candidates.times);
+    const size_t i = indexOf(&particle);
+    for (size_t k = 0; k < candidates.index.size(); ++k) {
+        addEvent(currentTime + candidates.times[k], EventType::Collision, i, candidates.index[k],
+                 particles_, events, simulationTime);
+    }
+
+    candidates.store.clear();
+    candidates.index.clear();
+}
+
+/**
+ * Add the particles stored in cell (cx, cy), with index first or larger, to the candidates,
+ * if the cell exists
+ * The trajectories are copied to the candidates store, so that the candidates are contiguous
+ */
+void CollisionSystem::gatherCell(Candidates& candidates, int cx, int cy, size_t first) const {
+    if (cx < 0 || cx >= gridSize_ || cy < 0 || cy >= gridSize_) {
+        return;
+    }
+    for (const Particle* p : cells_[cy * gridSize_ + cx]) {
+        const size_t j = indexOf(p);
+        if (j >= first) {
+            candidates.store.append(store_, j);
+            candidates.index.push_back(j);
+        }
+    }
+}
+
+/**
+ * Predict the events of all particles at the start of the simulation, in parallel
+ * Each pair of particles is predicted once, by the particle with the smaller index
+ */
+std::vector<std::vector<Event>> CollisionSystem::predictAll(double currentTime,
+                                                            double simulationTime) {
+    ScopedTimer timer{stats_.predictSeconds};
+
+    constexpr size_t chunksPerThread = 16;  // small chunks balance the uneven work per particle
+
+    const size_t n = particles_.size();
+    const size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t chunkSize = std::max<size_t>(n / (threads * chunksPerThread), 1);
+    const size_t chunks = (n + chunkSize - 1) / chunkSize;
+
+    // each thread takes the next chunk of particles until all are predicted
+    std::vector<std::vector<Event>> buffers(chunks);
+    std::atomic<size_t> nextChunk = 0;
+    auto work = [&]() {
+        Candidates candidates;
+        for (size_t c = nextChunk++; c < chunks; c = nextChunk++) {
+            const size_t last = std::min((c + 1) * chunkSize, n);
+            for (size_t i = c * chunkSize; i < last; ++i) {
+                predict(buffers[c], candidates, particles_[i], currentTime, simulationTime,
+                        i + 1);
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> pool;
+        for (size_t t = 1; t < std::min(threads, chunks); ++t) {
+            pool.emplace_back(work);
+        }
+        work();
+    }  // join
+
+    return buffers;
+}
+
+/**
+ * Add to events the event of particle leaving its current cell
+ * The particle need not have been moved to currentTime, the crossing is predicted from the
+ * time of its position
+ */
+void CollisionSystem::predictCellCrossing(std::vector<Event>& events, Particle& particle,
+                                          double currentTime, double simulationTime) const {
+    const double w = 1.0 / gridSize_;
+    const size_t i = indexOf(&particle);
+    const int cell = cellOf_[i];
+
+    int nextX, nextY;
+    const double dtX = timeToLeaveCell(particle.r.x, particle.v.x, cell % gridSize_, gridSize_, w,
+                                       nextX);
+    const double dtY = timeToLeaveCell(particle.r.y, particle.v.y, cell / gridSize_, gridSize_, w,
+                                       nextY);
+
+    if (dtX < dtY) {
+        addEvent(std::max(particle.time + dtX, currentTime), EventType::CellCrossing, i,
+                 (cell / gridSize_) * gridSize_ + nextX, particles_, events, simulationTime);
+    } else if (dtY < std::numeric_limits<double>::infinity()) {
+        addEvent(std::max(particle.time + dtY, currentTime), EventType::CellCrossing, i,
+                 nextY * gridSize_ + cell % gridSize_, particles_, events, simulationTime);
+    }
+}
+
+/**
+ * Add to events the collisions of particle with particles in the cells that became
+ * neighbors when particle left previousCell, followed by its next cell crossing
+ * Each pair is predicted as Neighborhood::AllPairs predicted it: by the particle whose velocity
+ * changed last, at that time, or by the one with the smaller index if neither changed since the
+ * start, so that both give identical events
+ */
+void CollisionSystem::predictNewNeighbors(std::vector<Event>& events, Particle& particle,
+                                          int previousCell, double currentTime,
+                                          double simulationTime) {
+    ScopedTimer timer{stats_.predictSeconds};
+
+    const int oldX = previousCell % gridSize_;
+    const int oldY = previousCell / gridSize_;
+
+    // particles in cells that were already neighbors have been considered before
+    const int cell = cellOf_[indexOf(&particle)];
+    const int cx = cell % gridSize_;
+    const int cy = cell / gridSize_;
+    for (int y = cy - 1; y <= cy + 1; ++y) {
+        for (int x = cx - 1; x <= cx + 1; ++x) {
+            if (std::abs(x - oldX) > 1 || std::abs(y - oldY) > 1) {
+                gatherCell(candidates_, x, y);
+            }
+        }
+    }
+
+    const size_t i = indexOf(&particle);
+    const Particle self = onTrajectory(particle, store_, i);
+    for (size_t k = 0; k < candidates_.index.size(); ++k) {
+        const size_t j = candidates_.index[k];
+        double dt = 0.0;
+        if (store_.time[i] > store_.time[j] || (store_.time[i] == store_.time[j] && i < j)) {
+            timeToHit(self, self.time, candidates_.store, k, {&dt, 1});
+            addEvent(std::max(self.time + dt, currentTime), EventType::Collision, i, j,
+                     particles_, events, simulationTime);
+        } else {
+            const Particle other = onTrajectory(particles_[j], store_, j);
+            timeToHit(other, other.time, store_, i, {&dt, 1});
+            addEvent(std::max(other.time + dt, currentTime), EventType::Collision, j, i,
+                     particles_, events, simulationTime);
+        }
+    }
+    candidates_.store.clear();
+    candidates_.index.clear();
+
+    predictCellCrossing(events, particle, currentTime, simulationTime);
+}
+
+/**
+ * Move particle to the given cell of the cell list
+ * Return the cell the particle was in before
+ */
+int CollisionSystem::enterCell(Particle& particle, int cell) {
+    int& current = cellOf_[indexOf(&particle)];
+    const int previous = current;
+
+    std::erase(cells_[current], &particle);
+    cells_[cell].push_back(&particle);
+    current = cell;
+
+    return previous;
+}
+
+void CollisionSystem::simulate(double simulationTime, double drawFrequenzy) {
+    // the particles are at their positions at the time of the simulation clock
+    for (auto& p : particles_) {
+        p.time = clock_;
+    }
+    store_ = ParticleStore{particles_};
+    nextCheckpoint_ = clock_ + options_.checkpointInterval;
+
+    stats_ = Statistics{};
+    startTime_ = std::chrono::steady_clock::now();
+    if (!options_.statisticsFile.empty()) {
+        statisticsOut_.open(options_.statisticsFile, std::ios::app);
+        if (!statisticsOut_) {
+            throw std::runtime_error(fmt::format("Unable to open statistics file {}",
+                                                 options_.statisticsFile.string()));
+        }
+    }
+
+    if (options_.scheduling == Scheduling::OnePerParticle) {
+        simulateOnePerParticle(simulationTime, drawFrequenzy);
+    } else if (options_.scheduling == Scheduling::Parallel) {
+        simulateParallel(simulationTime, drawFrequenzy);
+    } else if (options_.queue == QueueBackend::Calendar) {
+        CalendarQueue<Event, EventTime> queue;
+        simulateAllEvents(queue, simulationTime, drawFrequenzy);
+    } else {
+        PriorityQueue<Event> queue;
+        simulateAllEvents(queue, simulationTime, drawFrequenzy);
+    }
+
+    conservation_.resync(particles_);
+    updateStatistics(clock_);
+    dumpStatistics();
+    statisticsOut_.close();
+
+    if (!options_.checkpointFile.empty()) {
+        checkpoint(options_.checkpointFile);
+    }
+}
+
+/**
+ * Write a checkpoint of the current state of the system to file
+ */
+void CollisionSystem::checkpoint(const std::filesystem::path& file) {
+    synchronize(clock_);
+    write_checkpoint(file, clock_, particles_);
+}
+
+/**
+ * Main simulation loop of Scheduling::AllEvents, with the given (empty) event queue
+ */
+template <class Queue>
+void CollisionSystem::simulateAllEvents(Queue& queue, double simulationTime,
+                                        double drawFrequenzy) {
+    std::vector<Event> events;    // events predicted, but not yet added to the queue
+    double currentTime = clock_;  // initialize simulation clock time
+
+    // add the first rendering event to the queue
+    addEvent(currentTime, EventType::Render, Event::none, Event::none, particles_, events,
+             simulationTime);
+    tossAll(events, queue);
+
+    // add all possible collisions of particle with other particles and walls to the queue,
+    // the queue is ordered once when the first event is removed
+    for (auto& buffer : predictAll(currentTime, simulationTime)) {
+        tossAll(buffer, queue);
+    }
+
+    // the main event-driven simulation loop
+    while (!queue.isEmpty()) {
+        // get impending event, discard if invalidated
+        const Event e = [&]() {
+            ScopedTimer timer{stats_.deleteMinSeconds};
+            return queue.deleteMin();
+        }();
+        if (!e.isValid(particles_)) {
+            ++stats_.staleEvents;
+            continue;
+        }
+        ++stats_.eventsProcessed;
+
+        const EventType type = e.type();
+        Particle* particleA = particle(e.particleA);  // pointer to particle A, possibly null
+        Particle* particleB = type == EventType::Collision ? particle(e.particleB) : nullptr;
+
+        currentTime = e.time;  // update simulation clock
+        report(e);
+
+        // update positions of the particles involved, the others are moved when needed; a
+        // particle crossing a cell is not moved, so that it moves in the same steps as with
+        // Neighborhood::AllPairs
+        {
+            ScopedTimer timer{stats_.moveSeconds};
+            if (particleA != nullptr && type != EventType::CellCrossing) {
+                particleA->moveTo(currentTime);
+            }
+            if (particleB != nullptr) particleB->moveTo(currentTime);
+        }
+
+        // process event: update velocity, if needed
+        if (type == EventType::CellCrossing) {
+            const int previousCell = enterCell(*particleA, e.cell());
+            predictNewNeighbors(events, *particleA, previousCell, currentTime, simulationTime);
+        } else if (type == EventType::Collision) {
+            track(particleA->bounceOff(*particleB), currentTime);  // particle-particle collision
+            store_.set(e.particleA, *particleA);
+            store_.set(e.particleB, *particleB);
+            predict(events, *particleA, currentTime, simulationTime);
+            predict(events, *particleB, currentTime, simulationTime);
+        } else if (type == EventType::VerticalWall) {
+            track(particleA->bounceOffVerticalWall(), currentTime);  // particle-vertical wall
+            store_.set(e.particleA, *particleA);
+            predict(events, *particleA, currentTime, simulationTime);
+        } else if (type == EventType::HorizontalWall) {
+            track(particleA->bounceOffHorizontalWall(), currentTime);  // particle-horizontal wall
+            store_.set(e.particleA, *particleA);
+            predict(events, *particleA, currentTime, simulationTime);
+        } else if (type == EventType::Render) {
+            // add another redraw event to the queue
+            addEvent(currentTime + 1.0 / drawFrequenzy, EventType::Render, Event::none,
+                     Event::none, particles_, events, simulationTime);
+            tossAll(events, queue);
+
+            if (render(currentTime, queue.size())) break;
+        }
+
+        // add the events predicted for the particles involved
+        tossAll(events, queue);
+        stats_.peakQueueSize = std::max(stats_.peakQueueSize, queue.size());
+    }
+
+    synchronize(currentTime);
+    clock_ = currentTime;
+}
+
+/**
+ * Main simulation loop of Scheduling::OnePerParticle
+ */
+void CollisionSystem::simulateOnePerParticle(double simulationTime, double drawFrequenzy) {
+    const size_t n = particles_.size();
+    const size_t renderSlot = n;       // queue slot of the rendering event
+    IndexedPriorityQueue<Event> queue(n + 1);  // earliest event of each particle
+    std::vector<Event> events;         // events predicted for one particle
+    double currentTime = clock_;       // initialize simulation clock time
+
+    // partner[i] is the other particle in the event of particle i, n if none
+    // watchers[j] contains (at least) all particles i with partner[i] == j
+    std::vector<size_t> partner(n, n);
+    std::vector<std::vector<size_t>> watchers(n);
+    std::vector<size_t> affected;  // particles whose event must be predicted again
+
+    // replace the event of particle i by its earliest possible event
+    auto schedule = [&](size_t i) {
+        Particle& particle = particles_[i];
+        particle.moveTo(currentTime);
+        predict(events, particle, currentTime, simulationTime);
+
+        partner[i] = n;
+        if (events.empty()) {
+            queue.remove(i);
+            return;
+        }
+
+        const Event& first = *std::min_element(events.begin(), events.end());
+        queue.update(i, first);
+        if (first.type() == EventType::Collision) {
+            const size_t j = first.particleB;
+            partner[i] = j;
+
+            // drop entries that no longer watch j before the list would grow
+            auto& w = watchers[j];
+            if (w.size() == w.capacity()) {
+                std::erase_if(w, [&](size_t k) { return partner[k] != j; });
+            }
+            w.push_back(i);
+        }
+        events.clear();
+    };
+
+    // collect the particles whose event involves particle j
+    auto collectWatchers = [&](size_t j) {
+        for (size_t i : watchers[j]) {
+            if (partner[i] == j) affected.push_back(i);
+        }
+        watchers[j].clear();
+    };
+
+    // add the first rendering event to the queue
+    if (currentTime < simulationTime) {
+        queue.insert(renderSlot, Event{currentTime});
+    }
+
+    // add the earliest event of each particle to the queue
+    for (size_t i = 0; i < n; ++i) {
+        schedule(i);
+    }
+
+    // the main event-driven simulation loop
+    while (!queue.isEmpty()) {
+        const size_t slot = queue.minHandle();
+        const Event e = [&]() {
+            ScopedTimer timer{stats_.deleteMinSeconds};
+            return queue.deleteMin();
+        }();
+        assert(e.isValid(particles_));  // events are replaced as soon as they are invalidated
+        ++stats_.eventsProcessed;
+
+        const EventType type = e.type();
+        Particle* particleA = particle(e.particleA);  // pointer to particle A, possibly null
+        Particle* particleB = type == EventType::Collision ? particle(e.particleB) : nullptr;
+
+        currentTime = e.time;  // update simulation clock
+        report(e);
+
+        // update positions of the particles involved, the others are moved when needed
+        {
+            ScopedTimer timer{stats_.moveSeconds};
+            if (particleA != nullptr) particleA->moveTo(currentTime);
+            if (particleB != nullptr) particleB->moveTo(currentTime);
+        }
+
+        // process event: update velocity, if needed
+        affected.clear();
+        if (type == EventType::CellCrossing) {
+            enterCell(*particleA, e.cell());
+            schedule(slot);
+        } else if (type == EventType::Collision) {
+            track(particleA->bounceOff(*particleB), currentTime);  // particle-particle collision
+            const size_t a = e.particleA;
+            const size_t b = e.particleB;
+            store_.set(a, *particleA);
+            store_.set(b, *particleB);
+            collectWatchers(a);
+            collectWatchers(b);
+            schedule(a);
+            schedule(b);
+            std::erase_if(affected, [&](size_t i) { return i == a || i == b; });
+        } else if (type == EventType::VerticalWall) {
+            track(particleA->bounceOffVerticalWall(), currentTime);  // particle-vertical wall
+            store_.set(slot, *particleA);
+            collectWatchers(slot);
+            schedule(slot);
+        } else if (type == EventType::HorizontalWall) {
+            track(particleA->bounceOffHorizontalWall(), currentTime);  // particle-horizontal wall
+            store_.set(slot, *particleA);
+            collectWatchers(slot);
+            schedule(slot);
+        } else if (type == EventType::Render) {
+            // add another redraw event to the queue
+            if (const double next = currentTime + 1.0 / drawFrequenzy; next < simulationTime) {
+                queue.insert(renderSlot, Event{next});
+            }
+
+            if (render(currentTime, queue.size())) break;
+        }
+
+        // the partners of particles that changed velocity must find new events
+        std::ranges::sort(affected);
+        const auto duplicates = std::ranges::unique(affected);
+        affected.erase(duplicates.begin(), duplicates.end());
+        for (size_t i : affected) {
+            schedule(i);
+        }
+        stats_.peakQueueSize = std::max(stats_.peakQueueSize, queue.size());
+    }
+
+    synchronize(currentTime);
+    clock_ = currentTime;
+}
+
+/**
+ * Scheduling::Parallel
+ *
+ * The columns of the cell list are divided into vertical strips, one per thread. Each strip
+ * owns the particles in its cells and keeps the earliest event of each of them in its own
+ * IndexedPriorityQueue, as Scheduling::OnePerParticle does for all particles. An event is local
+ * to its strip if everything it reads or writes belongs to the strip: its particles, the
+ * particles whose partner they are, and the cells around all of them. This holds when these
+ * particles are in interior columns, whose neighboring columns belong to the same strip.
+ *
+ * The simulation alternates between
+ *   - serial phases, processing the earliest event of all strips, one at a time, until the
+ *     earliest event is local. Rendering and events at strip boundaries are processed here.
+ *   - parallel phases, where each strip processes its local events in time order, up to a
+ *     common horizon (at most the next rendering event, and a window after the serial phase
+ *     that adapts to the length of the previous parallel phases). A strip whose next event is not
+ *     local lowers the horizon to the time of that event and stops. Local events of different
+ *     strips touch disjoint data, so they may be processed in any order, but an event of
+ *     another strip may be earlier than the events that a strip has already processed.
+ *     Since hard disks can collide at any moment there is no lookahead to rely on, so each
+ *     strip logs the state it changes instead: when all strips have stopped, the events at or
+ *     after the final horizon are undone.
+ * Thus exactly the events before the horizon are processed in the parallel phase, and every
+ * particle sees the same events in the same order as with Scheduling::OnePerParticle, which
+ * gives identical results.
+ */
+class CollisionSystem::StripScheduler {
+public:
+    /**
+     * Constructor to divide the cell list of system into the given number of strips
+     */
+    StripScheduler(CollisionSystem& system, size_t strips);
+
+    /**
+     * Main simulation loop, see CollisionSystem::simulate
+     */
+    void run(double simulationTime, double drawFrequenzy);
+
+private:
+    /**
+     * State of a particle before it was changed by an event of a parallel phase
+     */
+    struct Saved {
+        size_t particle;
+        Particle state;
+        size_t partner;
+        int cell;
+        std::optional<Event> event;  // event of the particle in the queue of its strip
+    };
+
+    /**
+     * An event of a parallel phase, with the sizes of the logs of its strip before it was
+     * processed
+     */
+    struct Mark {
+        EventRecord record;     // to report when the phase is over
+        EnergyMomentum change;  // to track when the phase is over
+        size_t saved;
+        size_t watchers;
+        size_t cells;
+    };
+
+    /**
+     * A strip of columns of the cell list and the particles in it
+     */
+    struct Strip {
+        IndexedPriorityQueue<Event> queue;  // earliest event of each particle, by handle
+        std::vector<size_t> particles;      // particle of each handle
+        std::vector<size_t> freeHandles;    // handles of particles that left the strip
+
+        Candidates candidates;         // buffers of the thread processing the strip
+        std::vector<Event> events;
+        std::vector<size_t> affected;  // particles whose event must be predicted again
+
+        // logs of the current parallel phase, to undo events after the horizon
+        bool logging = false;
+        std::vector<Mark> marks;
+        std::vector<Saved> saved;
+        ParticleStore trajectories;  // trajectory of each saved particle
+        std::vector<std::pair<size_t, std::vector<size_t>>> watchers;
+        std::vector<std::pair<int, std::vector<Particle*>>> cells;
+    };
+
+    /**
+     * Return the strip of the given cell
+     */
+    size_t stripOf(int cell) const { return stripOfColumn_[cell % system_.gridSize_]; }
+
+    /**
+     * Check whether the column of the given cell and its neighboring columns are in the same
+     * strip
+     */
+    bool isInterior(int cell) const { return interior_[cell % system_.gridSize_]; }
+
+    /**
+     * Return the partner of particle k, which may be read while another strip changes it
+     */
+    size_t partner(size_t k) {
+        return std::atomic_ref<size_t>{partner_[k]}.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Set the partner of particle k
+     */
+    void setPartner(size_t k, size_t j) {
+        std::atomic_ref<size_t>{partner_[k]}.store(j, std::memory_order_relaxed);
+    }
+
+    /**
+     * Return the earliest event of all strips, and the strip of its particle
+     * Return null if there are no events
+     */
+    Strip* earliest();
+
+    /**
+     * Return the number of events in the queues, including the next rendering event
+     */
+    size_t queueSize(double nextRender) const;
+
+    /**
+     * Check whether event e of particle i, the earliest event of strip s, is local to s
+     */
+    bool isLocal(size_t s, size_t i, const Event& e);
+
+    /**
+     * Check whether all particles whose partner is j are in interior columns of strip s
+     */
+    bool isWatchedLocally(size_t s, size_t j);
+
+    /**
+     * Process the earliest event of strip, which involves particle i
+     */
+    void process(Strip& strip, size_t i);
+
+    /**
+     * Replace the event of particle k by its earliest possible event after time t
+     * The prediction uses the buffers of strip
+     */
+    void schedule(Strip& strip, size_t k, double t);
+
+    /**
+     * Add the particles whose event involves particle j to the affected particles of strip
+     */
+    void collectWatchers(Strip& strip, size_t j);
+
+    /**
+     * Move particle k to the queue of strip to, in a serial phase
+     */
+    void migrate(size_t k, size_t to);
+
+    /**
+     * Save the state of particle k in the log of strip, if in a parallel phase
+     */
+    void save(Strip& strip, size_t k);
+
+    /**
+     * Process the local events of strip s before the horizon, in a parallel phase
+     */
+    void processLocal(size_t s);
+
+    /**
+     * End a parallel phase: undo the events at or after the horizon, then report and track
+     * the others
+     */
+    void finishPhase();
+
+    CollisionSystem& system_;
+    std::vector<Strip> strips_;
+    std::vector<size_t> stripOfColumn_;  // strip of each column of the cell list
+    std::vector<char> interior_;         // whether each column is interior to its strip
+
+    std::vector<size_t> stripOf_;  // strip of each particle, only changed in serial phases
+    std::vector<size_t> handle_;   // handle of each particle in the queue of its strip
+
+    // partner_[i] is the other particle in the event of particle i, n if none
+    // watchers_[j] contains (at least) all particles i with partner_[i] == j
+    std::vector<size_t> partner_;
+    std::vector<std::vector<size_t>> watchers_;
+
+    std::atomic<double> horizon_ = 0.0;  // end of the current parallel phase
+    double window_ = infinity;           // largest length of a parallel phase
+    double currentTime_ = 0.0;           // time of the last event processed
+    double simulationTime_ = 0.0;
+};
+
+/**
+ * Constructor to divide the cell list of system into the given number of strips
+ */
+CollisionSystem::StripScheduler::StripScheduler(CollisionSystem& system, size_t strips)
+    : system_{system}
+    , strips_(strips)
+    , stripOfColumn_(system.gridSize_)
+    , interior_(system.gridSize_) {
+    const size_t columns = system.gridSize_;
+    for (size_t x = 0; x < columns; ++x) {
+        stripOfColumn_[x] = x * strips / columns;
+    }
+    for (size_t x = 0; x < columns; ++x) {
+        interior_[x] = stripOfColumn_[std::max(x, size_t{1}) - 1] == stripOfColumn_[x] &&
+                       stripOfColumn_[std::min(x + 1, columns - 1)] == stripOfColumn_[x];
+    }
+
+    const size_t n = system.particles_.size();
+    stripOf_.resize(n);
+    handle_.resize(n);
+    partner_.assign(n, n);
+    watchers_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        stripOf_[i] = stripOf(system.cellOf_[i]);
+        Strip& strip = strips_[stripOf_[i]];
+        handle_[i] = strip.particles.size();
+        strip.particles.push_back(i);
+    }
+    for (auto& strip : strips_) {
+        strip.queue.reserve(strip.particles.size());
+    }
+}
+
+/**
+ * Main simulation loop of Scheduling::Parallel
+ */
+void CollisionSystem::simulateParallel(double simulationTime, double drawFrequenzy) {
+    const size_t threads =
+        options_.threads > 0 ? options_.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t strips = std::min<size_t>(threads, gridSize_ / minStripColumns);
+    if (strips < 2) {
+        simulateOnePerParticle(simulationTime, drawFrequenzy);
+        return;
+    }
+
+    StripScheduler scheduler{*this, strips};
+    scheduler.run(simulationTime, drawFrequenzy);
+}
+
+/**
+ * Main simulation loop, see CollisionSystem::simulate
+ */
+void CollisionSystem::StripScheduler::run(double simulationTime, double drawFrequenzy) {
+    auto& stats = system_.stats_;
+    simulationTime_ = simulationTime;
+    currentTime_ = system_.clock_;
+    double nextRender = currentTime_ < simulationTime ? currentTime_ : infinity;
+
+    // add the earliest event of each particle to the queue of its strip
+    for (size_t i = 0; i < partner_.size(); ++i) {
+        schedule(strips_[stripOf_[i]], i, currentTime_);
+    }
+
+    // the main thread processes strip 0, the other threads wait for the parallel phases
+    bool done = false;
+    std::barrier sync{static_cast<std::ptrdiff_t>(strips_.size())};
+    std::vector<std::jthread> pool;
+    for (size_t s = 1; s < strips_.size(); ++s) {
+        pool.emplace_back([&, s]() {
+            while (true) {
+                sync.arrive_and_wait();  // start of a parallel phase, or the end
+                if (done) return;
+                processLocal(s);
+                sync.arrive_and_wait();  // end of the parallel phase
+            }
+        });
+    }
+
+    // release the threads when leaving the loop, also by an exception
+    struct Release {
+        bool& done;
+        std::barrier<>& sync;
+        ~Release() {
+            done = true;
+            sync.arrive_and_wait();
+        }
+    } release{done, sync};
+
+    // the main event-driven simulation loop
+    while (true) {
+        // serial phase: process the earliest event
+        Strip* strip = earliest();
+        if (strip == nullptr && nextRender == infinity) {
+            break;
+        }
+
+        if (strip == nullptr || nextRender < strip->queue.findMin().getTime()) {
+            currentTime_ = nextRender;
+            ++stats.eventsProcessed;
+            system_.report(Event{currentTime_});
+
+            // next rendering event
+            const double next = currentTime_ + 1.0 / drawFrequenzy;
+            nextRender = next < simulationTime ? next : infinity;
+
+            if (system_.render(currentTime_, queueSize(nextRender))) break;
+            continue;
+        }
+
+        process(*strip, strip->particles[strip->queue.minHandle()]);
+        stats.peakQueueSize = std::max(stats.peakQueueSize, queueSize(nextRender));
+
+        // parallel phase, while the earliest event is local
+        strip = earliest();
+        if (strip == nullptr) {
+            continue;
+        }
+        const Event& e = strip->queue.findMin();
+        const size_t s = static_cast<size_t>(strip - strips_.data());
+        if (!(e.getTime() < nextRender) ||
+            !isLocal(s, strip->particles[strip->queue.minHandle()], e)) {
+            continue;
+        }
+
+        // strips that run far ahead of the others would mostly do work that is undone, so
+        // the phase is limited to about twice the length of the previous phase
+        const double start = currentTime_;
+        const double limit = std::min(nextRender, start + window_);
+        horizon_ = limit;
+        for (auto& x : strips_) {
+            x.logging = true;
+        }
+        sync.arrive_and_wait();
+        processLocal(0);
+        sync.arrive_and_wait();
+        finishPhase();
+
+        const double end = horizon_;
+        if (end < limit) {
+            window_ = 2.0 * (end - start);
+        } else if (limit < nextRender) {
+            window_ = window_ > 0.0 ? 2.0 * window_ : infinity;
+        }
+        stats.peakQueueSize = std::max(stats.peakQueueSize, queueSize(nextRender));
+    }
+
+    system_.synchronize(currentTime_);
+    system_.clock_ = currentTime_;
+}
+
+/**
+ * Return the earliest event of all strips, and the strip of its particle
+ */
+CollisionSystem::StripScheduler::Strip* CollisionSystem::StripScheduler::earliest() {
+    Strip* first = nullptr;
+    for (auto& strip : strips_) {
+        if (!strip.queue.isEmpty() &&
+            (first == nullptr || strip.queue.findMin() < first->queue.findMin())) {
+            first = &strip;
+        }
+    }
+    return first;
+}
+
+/**
+ * Return the number of events in the queues, including the next rendering event
+ */
+size_t CollisionSystem::StripScheduler::queueSize(double nextRender) const {
+    size_t size = nextRender < infinity ? 1 : 0;
+    for (const auto& strip : strips_) {
+        size += strip.queue.size();
+    }
+    return size;
+}
+
+/**
+ * Check whether event e of particle i, the earliest event of strip s, is local to s
+ * Only reads data of strip s, and the partners of other particles
+ */
+bool CollisionSystem::StripScheduler::isLocal(size_t s, size_t i, const Event& e) {
+    const auto& cellOf = system_.cellOf_;
+
+    const EventType type = e.type();
+    if (type == EventType::CellCrossing) {
+        return stripOf(e.cell()) == s && isInterior(e.cell());
+    }
+    if (!isInterior(cellOf[i]) || !isWatchedLocally(s, i)) {
+        return false;
+    }
+    if (type == EventType::Collision) {
+        const size_t j = e.particleB;
+        return stripOf_[j] == s && isInterior(cellOf[j]) && isWatchedLocally(s, j);
+    }
+    return true;
+}
+
+/**
+ * Check whether all particles whose partner is j are in interior columns of strip s
+ */
+bool CollisionSystem::StripScheduler::isWatchedLocally(size_t s, size_t j) {
+    for (size_t k : watchers_[j]) {
+        if (partner(k) == j && (stripOf_[k] != s || !isInterior(system_.cellOf_[k]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Process the earliest event of strip, which involves particle i
+ * In a parallel phase, the changes are logged and the event is reported later
+ */
+void CollisionSystem::StripScheduler::process(Strip& strip, size_t i) {
+    auto& particles = system_.particles_;
+    auto& store = system_.store_;
+
+    const Event e = strip.queue.findMin();
+    const double t = e.getTime();
+    const EventType type = e.type();
+    const size_t j = type == EventType::Collision ? e.particleB : partner_.size();
+
+    if (strip.logging) {
+        const std::uint32_t b = j < partner_.size() ? e.particleB : EventRecord::noParticle;
+        strip.marks.push_back({EventRecord{t, type, e.particleA, b}, EnergyMomentum{},
+                               strip.saved.size(), strip.watchers.size(), strip.cells.size()});
+    } else {
+        currentTime_ = t;
+        ++system_.stats_.eventsProcessed;
+        system_.report(e);
+    }
+
+    save(strip, i);
+    if (j < partner_.size()) save(strip, j);
+    strip.queue.deleteMin();
+
+    // update positions of the particles involved, the others are moved when needed
+    particles[i].moveTo(t);
+    if (j < partner_.size()) particles[j].moveTo(t);
+
+    // process event: update velocity, if needed
+    EnergyMomentum change;
+    strip.affected.clear();
+    if (type == EventType::CellCrossing) {
+        if (strip.logging) {
+            const int cell = system_.cellOf_[i];
+            strip.cells.emplace_back(cell, system_.cells_[cell]);
+            strip.cells.emplace_back(e.cell(), system_.cells_[e.cell()]);
+        }
+        system_.enterCell(particles[i], e.cell());
+        schedule(strip, i, t);
+    } else if (type == EventType::Collision) {
+        change = particles[i].bounceOff(particles[j]);  // particle-particle collision
+        store.set(i, particles[i]);
+        store.set(j, particles[j]);
+        collectWatchers(strip, i);
+        collectWatchers(strip, j);
+        schedule(strip, i, t);
+        schedule(strip, j, t);
+        std::erase_if(strip.affected, [&](size_t k) { return k == i || k == j; });
+    } else if (type == EventType::VerticalWall) {
+        change = particles[i].bounceOffVerticalWall();  // particle-vertical wall collision
+        store.set(i, particles[i]);
+        collectWatchers(strip, i);
+        schedule(strip, i, t);
+    } else if (type == EventType::HorizontalWall) {
+        change = particles[i].bounceOffHorizontalWall();  // particle-horizontal wall collision
+        store.set(i, particles[i]);
+        collectWatchers(strip, i);
+        schedule(strip, i, t);
+    }
+
+    // the changes of a parallel phase are tracked in the order of the sequential simulation
+    if (strip.logging) {
+        strip.marks.back().change = change;
+    } else if (type != EventType::CellCrossing) {
+        system_.track(change, t);
+    }
+
+    // the partners of particles that changed velocity must find new events
+    std::ranges::sort(strip.affected);
+    const auto duplicates = std::ranges::unique(strip.affected);
+    strip.affected.erase(duplicates.begin(), duplicates.end());
+    for (size_t k : strip.affected) {
+        schedule(strip, k, t);
+    }
+}
+
+/**
+ * Replace the event of particle k by its earliest possible event after time t
+ */
+void CollisionSystem::StripScheduler::schedule(Strip& strip, size_t k, double t) {
+    save(strip, k);
+
+    Particle& particle = system_.particles_[k];
+    particle.moveTo(t);
+    system_.predict(strip.events, strip.candidates, particle, t, simulationTime_, 0);
+
+    setPartner(k, partner_.size());
+    if (const size_t s = stripOf(system_.cellOf_[k]); s != stripOf_[k]) {
+        migrate(k, s);
+    }
+
+    auto& queue = strips_[stripOf_[k]].queue;
+    if (strip.events.empty()) {
+        queue.remove(handle_[k]);
+        return;
+    }
+
+    const Event& first = *std::min_element(strip.events.begin(), strip.events.end());
+    queue.update(handle_[k], first);
+    if (first.type() == EventType::Collision) {
+        const size_t j = first.particleB;
+        setPartner(k, j);
+
+        // drop entries that no longer watch j before the list would grow
+        auto& w = watchers_[j];
+        if (strip.logging) strip.watchers.emplace_back(j, w);
+        if (w.size() == w.capacity()) {
+            std::erase_if(w, [&](size_t x) { return partner(x) != j; });
+        }
+        w.push_back(k);
+    }
+    strip.events.clear();
+}
+
+/**
+ * Add the particles whose event involves particle j to the affected particles of strip
+ */
+void CollisionSystem::StripScheduler::collectWatchers(Strip& strip, size_t j) {
+    auto& w = watchers_[j];
+    for (size_t k : w) {
+        if (partner(k) == j) strip.affected.push_back(k);
+    }
+    if (strip.logging) strip.watchers.emplace_back(j, w);
+    w.clear();
+}
+
+/**
+ * Move particle k to the queue of strip to, in a serial phase
+ */
+void CollisionSystem::StripScheduler::migrate(size_t k, size_t to) {
+    Strip& from = strips_[stripOf_[k]];
+    assert(!from.logging);
+    from.queue.remove(handle_[k]);
+    from.freeHandles.push_back(handle_[k]);
+
+    Strip& strip = strips_[to];
+    if (strip.freeHandles.empty()) {
+        handle_[k] = strip.particles.size();
+        strip.particles.push_back(k);
+        strip.queue.reserve(strip.particles.size());
+    } else {
+        handle_[k] = strip.freeHandles.back();
+        strip.freeHandles.pop_back();
+        strip.particles[handle_[k]] = k;
+    }
+    stripOf_[k] = to;
+}
+
+/**
+ * Save the state of particle k in the log of strip, if in a parallel phase
+ */
+void CollisionSystem::StripScheduler::save(Strip& strip, size_t k) {
+    if (!strip.logging) {
+        return;
+    }
+
+    // in a parallel phase, k belongs to strip
+    const size_t h = handle_[k];
+    std::optional<Event> event;
+    if (strip.queue.contains(h)) event = strip.queue.get(h);
+
+    strip.saved.push_back({k, system_.particles_[k], partner_[k], system_.cellOf_[k], event});
+    strip.trajectories.append(system_.store_, k);
+}
+
+/**
+ * Process the local events of strip s before the horizon, in a parallel phase
+ */
+void CollisionSystem::StripScheduler::processLocal(size_t s) {
+    Strip& strip = strips_[s];
+    while (!strip.queue.isEmpty()) {
+        const Event& e = strip.queue.findMin();
+        const double t = e.getTime();
+        if (!(t < horizon_.load(std::memory_order_relaxed))) {
+            return;
+        }
+
+        const size_t i = strip.particles[strip.queue.minHandle()];
+        if (!isLocal(s, i, e)) {
+            // the events of all strips must stop before this event
+            double horizon = horizon_.load(std::memory_order_relaxed);
+            while (t < horizon &&
+                   !horizon_.compare_exchange_weak(horizon, t, std::memory_order_relaxed)) {
+            }
+            return;
+        }
+        process(strip, i);
+    }
+}
+
+/**
+ * End a parallel phase: undo the events at or after the horizon, then report and track the
+ * others
+ */
+void CollisionSystem::StripScheduler::finishPhase() {
+    const double horizon = horizon_.load();
+    auto& particles = system_.particles_;
+
+    std::vector<Mark> kept;
+    for (auto& strip : strips_) {
+        // undo the events at or after the horizon, most recent changes first
+        const auto end = std::ranges::lower_bound(strip.marks, horizon, {},
+                                                  [](const Mark& m) { return m.record.time; });
+        if (end != strip.marks.end()) {
+            for (size_t x = strip.saved.size(); x-- > end->saved;) {
+                const Saved& saved = strip.saved[x];
+                const size_t k = saved.particle;
+                particles[k] = saved.state;
+                system_.store_.set(k, strip.trajectories, x);
+                partner_[k] = saved.partner;
+                system_.cellOf_[k] = saved.cell;
+                if (saved.event) {
+                    strip.queue.update(handle_[k], *saved.event);
+                } else {
+                    strip.queue.remove(handle_[k]);
+                }
+            }
+            for (size_t x = strip.watchers.size(); x-- > end->watchers;) {
+                watchers_[strip.watchers[x].first] = std::move(strip.watchers[x].second);
+            }
+            for (size_t x = strip.cells.size(); x-- > end->cells;) {
+                system_.cells_[strip.cells[x].first] = std::move(strip.cells[x].second);
+            }
+        }
+
+        if (end != strip.marks.begin()) {
+            currentTime_ = std::max(currentTime_, std::prev(end)->record.time);
+        }
+        system_.stats_.eventsProcessed += end - strip.marks.begin();
+        kept.insert(kept.end(), strip.marks.begin(), end);
+
+        strip.logging = false;
+        strip.marks.clear();
+        strip.saved.clear();
+        strip.trajectories.clear();
+        strip.watchers.clear();
+        strip.cells.clear();
+    }
+
+    // report and track the events in the order of the sequential simulation
+    std::ranges::sort(kept, [](const Mark& a, const Mark& b) {
+        return std::tie(a.record.time, a.record.particleA) <
+               std::tie(b.record.time, b.record.particleA);
+    });
+    for (const auto& mark : kept) {
+        if (system_.eventCallback) system_.eventCallback(mark.record);
+        if (mark.record.type != EventType::CellCrossing) {
+            system_.track(mark.change, mark.record.time);
+        }
+    }
+}
+
+/**
+ * Report event e to eventCallback, if any
+ */
+void CollisionSystem::report(const Event& e) const {
+    if (!eventCallback) {
+        return;
+    }
+
+    const std::uint32_t b = e.type() == EventType::Collision ? e.particleB : EventRecord::noParticle;
+    eventCallback(EventRecord{e.time, e.type(), e.particleA, b});
+}
+
+/**
+ * Add the change of the kinetic energy and momentum in an event at currentTime to the totals
+ * driftCallback is called when the drift of the energy exceeds the tolerance, and again only
+ * after the drift was back within the tolerance
+ */
+void CollisionSystem::track(const EnergyMomentum& change, double currentTime) {
+    conservation_.add(change);
+    if (options_.driftTolerance <= 0.0) {
+        return;
+    }
+
+    const double drift = conservation_.energyDrift();
+    const bool drifted = std::abs(drift) > options_.driftTolerance;
+    if (drifted && !drifted_ && driftCallback) {
+        driftCallback(currentTime, drift);
+    }
+    drifted_ = drifted;
+}
+
+/**
+ * Process a rendering event at currentTime
+ * Return true if the simulation should be aborted
+ */
+bool CollisionSystem::render(double currentTime, size_t queueSize) {
+    synchronize(currentTime);
+    conservation_.resync(particles_);  // drop the rounding errors of the tracked changes
+    updateStatistics(currentTime);
+    dumpStatistics();
+
+    if (!options_.checkpointFile.empty() && options_.checkpointInterval > 0.0 &&
+        currentTime >= nextCheckpoint_) {
+        write_checkpoint(options_.checkpointFile, currentTime, particles_);
+        nextCheckpoint_ = currentTime + options_.checkpointInterval;
+    }
+
+    if (renderCallback) {
+        renderCallback(particles_);
+    }
+
+    if (options_.printProgress) {
+        fmt::print("Simulation Time: {:8.3f}, Queue Size: {:10}\n", currentTime, queueSize);
+    }
+
+    return abortCallback && abortCallback();  // in case user closes the simulation window
+}
+
+/**
+ * Update the clocks of the statistics at simulation time currentTime
+ */
+void CollisionSystem::updateStatistics(double currentTime) {
+    stats_.simulationTime = currentTime;
+    stats_.energyDrift = conservation_.energyDrift();
+    stats_.totalSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_).count();
+}
+
+/**
+ * Append the statistics to the statistics file, if any
+ */
+void CollisionSystem::dumpStatistics() {
+    if (statisticsOut_.is_open()) {
+        statisticsOut_ << stats_.toJson() << '\n';
+    }
+}
+
+/**
+ * Return the statistics as a JSON object, on a single line
+ */
+std::string CollisionSystem::Statistics::toJson() const {
+    return fmt::format(
+        "{{\"simulationTime\": {}, \"eventsProcessed\": {}, \"staleEvents\": {}, "
+        "\"peakQueueSize\": {}, \"predictSeconds\": {}, \"deleteMinSeconds\": {}, "
+        "\"moveSeconds\": {}, \"totalSeconds\": {}, \"eventsPerSecond\": {}, "
+        "\"energyDrift\": {}}}",
+        simulationTime, eventsProcessed, staleEvents, peakQueueSize, predictSeconds,
+        deleteMinSeconds, moveSeconds, totalSeconds, eventsPerSecond(), energyDrift);
+}
+
+/**
+ * Move all particles to their positions at time t
+ */
+void CollisionSystem::synchronize(double t) {
+    ScopedTimer timer{stats_.moveSeconds};
+    for (auto& p : particles_) {
+        p.moveTo(t);
+    }
+}
+
+ /**
+ * Return a vector with all system particles
+ */
+const std::vector<Particle>& CollisionSystem::particles() const { return particles_; }
+
+}  // namespace particlesystem
@@ -0,0 +1,57 @@
+#include <particlesystem/conservation.h>
+
+#include <cmath>
+
+namespace particlesystem {
+
+/**
+ * Add x to the sum
+ */
+void CompensatedSum::add(double x) {
+    const double t = sum_ + x;
+    // the rounding error of t is exact, computed from the larger of the terms
+    if (std::abs(sum_) >= std::abs(x)) {
+        compensation_ += (sum_ - t) + x;
+    } else {
+        compensation_ += (x - t) + sum_;
+    }
+    sum_ = t;
+}
+
+/**
+ * Recompute the totals from the particles and make the energy the reference
+ */
+void ConservationMonitor::reset(std::span<const Particle> particles) {
+    resync(particles);
+    reference_ = energy_.value();
+}
+
+/**
+ * Recompute the totals from the particles, keeping the reference
+ */
+void ConservationMonitor::resync(std::span<const Particle> particles) {
+    energy_ = CompensatedSum{};
+    momentumX_ = CompensatedSum{};
+    momentumY_ = CompensatedSum{};
+    for (const auto& p : particles) {
+        add({p.kineticEnergy(), p.momentum()});
+    }
+}
+
+/**
+ * Add the change of the particles in an event
+ */
+void ConservationMonitor::add(const EnergyMomentum& change) {
+    energy_.add(change.energy);
+    momentumX_.add(change.momentum.x);
+    momentumY_.add(change.momentum.y);
+}
+
+/**
+ * Return the relative change of the energy since the reference
+ */
+double ConservationMonitor::energyDrift() const {
+    return reference_ != 0.0 ? (energy_.value() - reference_) / reference_ : 0.0;
+}
+
+}  // namespace particlesystem
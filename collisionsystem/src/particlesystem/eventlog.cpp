@@ -0,0 +1,62 @@
+#include <particlesystem/eventlog.h>
+
+#include <stdexcept>
+#include <type_traits>
+#include <fmt/format.h>
+
+namespace particlesystem {
+
+/**
+ * Constructor to create the log file for a system of particleCount particles
+ */
+EventLog::EventLog(const std::filesystem::path& file, size_t particleCount)
+    : out_{file, std::ios::binary | std::ios::trunc} {
+    if (!out_) {
+        throw std::runtime_error(fmt::format("Unable to create event log {}", file.string()));
+    }
+
+    out_.write("PSEL", 4);
+    put(version);
+    put(static_cast<std::uint32_t>(particleCount));
+}
+
+/**
+ * Append a processed event
+ */
+void EventLog::write(const CollisionSystem::EventRecord& e) {
+    put('E');
+    put(e.time);
+    put(e.type);
+    put(e.particleA);
+    put(e.particleB);
+}
+
+/**
+ * Append a snapshot of the positions and velocities of the particles at the given time
+ */
+void EventLog::writeSnapshot(double time, std::span<const Particle> particles) {
+    put('S');
+    put(time);
+    put(static_cast<std::uint32_t>(particles.size()));
+    for (const auto& p : particles) {
+        put(p.r.x);
+        put(p.r.y);
+        put(p.v.x);
+        put(p.v.y);
+    }
+}
+
+/**
+ * Append the bytes of x
+ */
+template <class T>
+void EventLog::put(const T& x) {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    out_.write(reinterpret_cast<const char*>(&x), sizeof(x));
+    if (!out_) {
+        throw std::runtime_error("Unable to write to event log");
+    }
+}
+
+}  // namespace particlesystem
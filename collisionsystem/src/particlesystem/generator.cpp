@@ -0,0 +1,126 @@
+#include <particlesystem/generator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace particlesystem {
+
+namespace {
+
+/**
+ * Number of random positions tried for a particle before giving up
+ */
+constexpr int maxAttempts = 10000;
+
+/**
+ * Help function to draw a value of the distribution with mean 1
+ */
+double sample(const Distribution& d, std::mt19937_64& rng) {
+    switch (d.kind) {
+        case Distribution::Kind::Uniform:
+            return std::uniform_real_distribution<double>{1.0 - d.spread, 1.0 + d.spread}(rng);
+        case Distribution::Kind::LogNormal: {
+            // parameters of the underlying normal distribution for mean 1, deviation spread
+            const double sigma2 = std::log1p(d.spread * d.spread);
+            return std::lognormal_distribution<double>{-0.5 * sigma2, std::sqrt(sigma2)}(rng);
+        }
+        case Distribution::Kind::Constant:
+        default:
+            return 1.0;
+    }
+}
+
+}  // namespace
+
+/**
+ * Generate a particle system in the unit box, without overlapping particles
+ */
+std::vector<Particle> generate_particles(const GeneratorOptions& options) {
+    const std::size_t n = options.count;
+    if (n == 0) {
+        return {};
+    }
+    std::mt19937_64 rng{options.seed};
+
+    // radii relative to each other, then scaled so that the particles cover the density
+    std::vector<Particle> particles(n);
+    for (auto& p : particles) {
+        p.radius = sample(options.radius, rng);
+    }
+    const double area = std::transform_reduce(particles.begin(), particles.end(), 0.0,
+                                              std::plus<>{}, [](const Particle& p) {
+                                                  return std::numbers::pi * p.radius * p.radius;
+                                              });
+    const double scale = std::sqrt(options.density / area);
+    const double rmsRadius = scale * std::sqrt(area / (std::numbers::pi * n));
+    for (auto& p : particles) {
+        p.radius *= scale;
+    }
+
+    // placed particles are kept in a grid of cells at least as wide as the largest diameter,
+    // so that a new particle can only overlap particles in its own and the 8 neighboring cells
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater<>{},
+                             [&](std::size_t i) { return particles[i].radius; });
+    const double largest = particles[order.front()].radius;
+    if (2.0 * largest >= 1.0) {
+        throw std::runtime_error(
+            fmt::format("Density {} is too high for {} particles", options.density, n));
+    }
+    const double fewCells = std::sqrt(static_cast<double>(n));
+    const int side = std::max(static_cast<int>(std::min(0.5 / largest, fewCells)), 1);
+    std::vector<std::vector<std::size_t>> grid(static_cast<std::size_t>(side) * side);
+    auto cellOf = [&](double x) { return std::clamp(static_cast<int>(x * side), 0, side - 1); };
+
+    auto overlaps = [&](const Particle& p) {
+        const int cx = cellOf(p.r.x);
+        const int cy = cellOf(p.r.y);
+        for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, side - 1); ++y) {
+            for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, side - 1); ++x) {
+                for (std::size_t j : grid[y * side + x]) {
+                    const glm::dvec2 d = particles[j].r - p.r;
+                    const double sigma = particles[j].radius + p.radius;
+                    if (glm::dot(d, d) < sigma * sigma) return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    std::uniform_real_distribution<double> unit{0.0, 1.0};
+    for (std::size_t i : order) {
+        Particle& p = particles[i];
+        const double room = 1.0 - 2.0 * p.radius;
+        int attempts = 0;
+        do {
+            if (++attempts > maxAttempts) {
+                throw std::runtime_error(
+                    fmt::format("Density {} is too high to place {} particles",
+                                options.density, n));
+            }
+            p.r.x = p.radius + room * unit(rng);
+            p.r.y = p.radius + room * unit(rng);
+        } while (overlaps(p));
+        grid[cellOf(p.r.y) * side + cellOf(p.r.x)].push_back(i);
+    }
+
+    std::normal_distribution<double> velocity{0.0, options.speed / std::numbers::sqrt2};
+    for (auto& p : particles) {
+        p.v.x = velocity(rng);
+        p.v.y = velocity(rng);
+
+        p.mass = sample(options.mass, rng);
+        if (options.massFromArea) {
+            p.mass *= (p.radius / rmsRadius) * (p.radius / rmsRadius);
+        }
+    }
+    return particles;
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,96 @@
+#include <particlesystem/mappedfile.h>
+
+#include <utility>
+#include <stdexcept>
+#include <fmt/format.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace particlesystem {
+
+/**
+ * Constructor to map the given file
+ */
+MappedFile::MappedFile(const std::filesystem::path& file) {
+    auto fail = [&]() {
+        throw std::runtime_error(fmt::format("Unable to map file {}", file.string()));
+    };
+
+    std::error_code ec;
+    size_ = static_cast<std::size_t>(std::filesystem::file_size(file, ec));
+    if (ec) {
+        fail();
+    }
+    if (size_ == 0) {  // nothing to map
+        return;
+    }
+
+#if defined(_WIN32)
+    HANDLE handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        fail();
+    }
+    HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);  // the mapping keeps the file open
+    if (mapping == nullptr) {
+        fail();
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);  // the view keeps the mapping alive
+    if (view == nullptr) {
+        fail();
+    }
+#else
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fail();
+    }
+    void* view = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps the file open
+    if (view == MAP_FAILED) {
+        fail();
+    }
+#endif
+    data_ = static_cast<const std::byte*>(view);
+}
+
+MappedFile::~MappedFile() { unmap(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)} {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+/**
+ * Unmap the file, if mapped
+ */
+void MappedFile::unmap() {
+    if (data_ == nullptr) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+}  // namespace particlesystem
@@ -10,7 +10,10 @@ namespace particlesystem {
  * to the laws of elastic collision. Assumes that the particles are colliding
  * at this instant
  */
-void Particle::bounceOff(Particle& that) {
+EnergyMomentum Particle::bounceOff(Particle& that) {
+    const double energyBefore = kineticEnergy() + that.kineticEnergy();
+    const glm::dvec2 momentumBefore = momentum() + that.momentum();
+
     const auto dr = that.r - r;
     const auto dv = that.v - v;
     const double dvdr = glm::dot(dv, dr);      // dv dot dr
@@ -29,6 +32,9 @@ void Particle::bounceOff(Particle& that) {
     // update collision counts
     count++;
     that.count++;
+
+    return {kineticEnergy() + that.kineticEnergy() - energyBefore,
+            momentum() + that.momentum() - momentumBefore};
 }
 
 /**
@@ -36,9 +42,10 @@ void Particle::bounceOff(Particle& that) {
  * wall (by reflecting the velocity in the x-direction).
  * Assumes that the particle is colliding with a vertical wall at this instant.
  */
-void Particle::bounceOffVerticalWall() {
+EnergyMomentum Particle::bounceOffVerticalWall() {
     v.x = -v.x;
     count++;
+    return {0.0, {2.0 * mass * v.x, 0.0}};
 }
 
 /**
@@ -46,9 +53,10 @@ void Particle::bounceOffVerticalWall() {
  * wall (by reflecting the velocity in the y-direction)
  * Assumes that the particle is colliding with a horizontal wall at this instant.
  */
-void Particle::bounceOffHorizontalWall() {
+EnergyMomentum Particle::bounceOffHorizontalWall() {
     v.y = -v.y;
     count++;
+    return {0.0, {0.0, 2.0 * mass * v.y}};
 }
 
 }  // namespace particlesystem
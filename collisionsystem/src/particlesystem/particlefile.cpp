@@ -0,0 +1,147 @@
+#include <particlesystem/particlefile.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace particlesystem {
+
+namespace {
+
+constexpr char magic[4] = {'P', 'S', 'P', 'F'};
+constexpr std::uint64_t columnAlignment = 64;
+
+/**
+ * Header of a binary particle file
+ */
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t count;
+    std::uint64_t offsets[ParticleFile::fieldCount];
+};
+
+/**
+ * Help function to round n up to a multiple of columnAlignment
+ */
+constexpr std::uint64_t alignColumn(std::uint64_t n) {
+    return (n + columnAlignment - 1) / columnAlignment * columnAlignment;
+}
+
+}  // namespace
+
+/**
+ * Return true if file starts like a binary particle file, of any version
+ */
+bool ParticleFile::isParticleFile(const std::filesystem::path& file) {
+    std::ifstream is(file, std::ios::binary);
+    char start[sizeof(magic)] = {};
+    return is.read(start, sizeof(start)) && std::memcmp(start, magic, sizeof(magic)) == 0;
+}
+
+/**
+ * Constructor to map the given file
+ */
+ParticleFile::ParticleFile(const std::filesystem::path& file) : file_{file} {
+    auto fail = [&](std::string_view reason) {
+        throw std::runtime_error(fmt::format("Invalid particle file {}: {}", file.string(), reason));
+    };
+
+    const auto bytes = file_.bytes();
+    Header header;
+    if (bytes.size() < sizeof(header)) {
+        fail("no header");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        fail("not a binary particle file");
+    }
+    if (header.version != version) {
+        fail(fmt::format("version {}, expected {}", header.version, version));
+    }
+
+    // every column must be aligned and lie completely within the file
+    for (std::size_t f = 0; f < fieldCount; ++f) {
+        const std::uint64_t offset = header.offsets[f];
+        if (offset % alignof(double) != 0 || offset < sizeof(header) || offset > bytes.size() ||
+            header.count > (bytes.size() - offset) / sizeof(double)) {
+            fail(fmt::format("column {} does not hold {} particles", f, header.count));
+        }
+        columns_[f] = reinterpret_cast<const double*>(bytes.data() + offset);
+    }
+    count_ = static_cast<std::size_t>(header.count);
+}
+
+/**
+ * Return particle i
+ */
+Particle ParticleFile::particle(std::size_t i) const {
+    auto get = [&](Field f) { return columns_[static_cast<std::size_t>(f)][i]; };
+
+    return Particle{.r = {get(Field::rx), get(Field::ry)},
+                    .v = {get(Field::vx), get(Field::vy)},
+                    .radius = get(Field::radius),
+                    .mass = get(Field::mass),
+                    .color = {static_cast<float>(get(Field::red)),
+                              static_cast<float>(get(Field::green)),
+                              static_cast<float>(get(Field::blue))}};
+}
+
+/**
+ * Return all particles
+ */
+std::vector<Particle> ParticleFile::particles() const {
+    std::vector<Particle> result;
+    result.reserve(count_);
+    for (std::size_t i = 0; i < count_; ++i) {
+        result.push_back(particle(i));
+    }
+    return result;
+}
+
+/**
+ * Write the particles to a binary particle file
+ */
+void write_particle_file(const std::filesystem::path& file, std::span<const Particle> particles) {
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = ParticleFile::version;
+    header.count = particles.size();
+
+    const std::uint64_t columnSize = alignColumn(particles.size() * sizeof(double));
+    for (std::size_t f = 0; f < ParticleFile::fieldCount; ++f) {
+        header.offsets[f] = alignColumn(sizeof(header)) + f * columnSize;
+    }
+
+    std::ofstream os(file, std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // write a column, padded up to the start of the next one
+    std::vector<double> column(columnSize / sizeof(double), 0.0);
+    auto write = [&](auto value) {
+        for (std::size_t i = 0; i < particles.size(); ++i) {
+            column[i] = value(particles[i]);
+        }
+        os.write(reinterpret_cast<const char*>(column.data()), columnSize);
+    };
+
+    const std::vector<char> padding(header.offsets[0] - sizeof(header), 0);
+    os.write(padding.data(), padding.size());
+    write([](const Particle& p) { return p.r.x; });
+    write([](const Particle& p) { return p.r.y; });
+    write([](const Particle& p) { return p.v.x; });
+    write([](const Particle& p) { return p.v.y; });
+    write([](const Particle& p) { return p.radius; });
+    write([](const Particle& p) { return p.mass; });
+    write([](const Particle& p) { return static_cast<double>(p.color.r); });
+    write([](const Particle& p) { return static_cast<double>(p.color.g); });
+    write([](const Particle& p) { return static_cast<double>(p.color.b); });
+
+    if (!os) {
+        throw std::runtime_error(fmt::format("Unable to write particle file {}", file.string()));
+    }
+}
+
+}  // namespace particlesystem
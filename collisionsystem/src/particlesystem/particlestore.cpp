@@ -0,0 +1,250 @@
+#include <particlesystem/particlestore.h>
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+// The variants of timeToHit only give identical results if no multiplication and addition are
+// fused into one, e.g. by -march=native or -mfma, which would round differently in the scalar
+// loop than in the vector lanes. MSVC does not fuse them unless /fp:contract is given.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace particlesystem {
+
+namespace {
+
+constexpr double infinity = std::numeric_limits<double>::infinity();
+
+/**
+ * Help function to compute the time for particle to collide with entry j of candidates
+ * Same computation as Particle::timeToHit, with the candidate moved to time t first
+ */
+double timeToHitScalar(const Particle& particle, double t, const ParticleStore& candidates,
+                       size_t j) {
+    const double rx = candidates.rx[j] + candidates.vx[j] * (t - candidates.time[j]);
+    const double ry = candidates.ry[j] + candidates.vy[j] * (t - candidates.time[j]);
+
+    const double drx = rx - particle.r.x;
+    const double dry = ry - particle.r.y;
+    const double dvx = candidates.vx[j] - particle.v.x;
+    const double dvy = candidates.vy[j] - particle.v.y;
+
+    const double dvdr = drx * dvx + dry * dvy;
+    if (dvdr > 0) {
+        return infinity;
+    }
+
+    const double dvdv = dvx * dvx + dvy * dvy;
+    if (dvdv == 0.0) {
+        return infinity;
+    }
+
+    const double drdr = drx * drx + dry * dry;
+    const double sigma = particle.radius + candidates.radius[j];
+    if (drdr < sigma * sigma) {
+        return infinity;
+    }
+
+    const double d = (dvdr * dvdr) - dvdv * (drdr - sigma * sigma);
+    if (d < 0.0) {
+        return infinity;
+    }
+
+    const double time = -(dvdr + std::sqrt(d)) / dvdv;
+    if (time < 0.0) {
+        return infinity;
+    }
+
+    return time;
+}
+
+#if defined(__AVX512F__)
+
+/**
+ * Help function to compute the times for entries [j, j+8) of candidates
+ * Lanes that fail one of the tests of timeToHitScalar are set to infinity afterwards
+ */
+void timeToHit8(const Particle& particle, __m512d t, const ParticleStore& candidates, size_t j,
+                double* times) {
+    const __m512d vx = _mm512_loadu_pd(&candidates.vx[j]);
+    const __m512d vy = _mm512_loadu_pd(&candidates.vy[j]);
+    const __m512d dt = _mm512_sub_pd(t, _mm512_loadu_pd(&candidates.time[j]));
+    const __m512d rx = _mm512_add_pd(_mm512_loadu_pd(&candidates.rx[j]), _mm512_mul_pd(vx, dt));
+    const __m512d ry = _mm512_add_pd(_mm512_loadu_pd(&candidates.ry[j]), _mm512_mul_pd(vy, dt));
+
+    const __m512d drx = _mm512_sub_pd(rx, _mm512_set1_pd(particle.r.x));
+    const __m512d dry = _mm512_sub_pd(ry, _mm512_set1_pd(particle.r.y));
+    const __m512d dvx = _mm512_sub_pd(vx, _mm512_set1_pd(particle.v.x));
+    const __m512d dvy = _mm512_sub_pd(vy, _mm512_set1_pd(particle.v.y));
+
+    const __m512d dvdr = _mm512_add_pd(_mm512_mul_pd(drx, dvx), _mm512_mul_pd(dry, dvy));
+    const __m512d dvdv = _mm512_add_pd(_mm512_mul_pd(dvx, dvx), _mm512_mul_pd(dvy, dvy));
+    const __m512d drdr = _mm512_add_pd(_mm512_mul_pd(drx, drx), _mm512_mul_pd(dry, dry));
+    const __m512d sigma =
+        _mm512_add_pd(_mm512_set1_pd(particle.radius), _mm512_loadu_pd(&candidates.radius[j]));
+    const __m512d sigma2 = _mm512_mul_pd(sigma, sigma);
+
+    const __m512d d = _mm512_sub_pd(_mm512_mul_pd(dvdr, dvdr),
+                                    _mm512_mul_pd(dvdv, _mm512_sub_pd(drdr, sigma2)));
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d sum = _mm512_add_pd(dvdr, _mm512_sqrt_pd(d));
+    const __m512d time = _mm512_div_pd(sum, _mm512_sub_pd(zero, dvdv));  // -sum / dvdv
+
+    const __mmask8 miss = _mm512_cmp_pd_mask(dvdr, zero, _CMP_GT_OQ) |
+                          _mm512_cmp_pd_mask(dvdv, zero, _CMP_EQ_OQ) |
+                          _mm512_cmp_pd_mask(drdr, sigma2, _CMP_LT_OQ) |
+                          _mm512_cmp_pd_mask(d, zero, _CMP_LT_OQ) |
+                          _mm512_cmp_pd_mask(time, zero, _CMP_LT_OQ);
+
+    _mm512_storeu_pd(times, _mm512_mask_blend_pd(miss, time, _mm512_set1_pd(infinity)));
+}
+
+#elif defined(__AVX2__)
+
+/**
+ * Help function to compute the times for entries [j, j+4) of candidates
+ * Lanes that fail one of the tests of timeToHitScalar are set to infinity afterwards
+ */
+void timeToHit4(const Particle& particle, __m256d t, const ParticleStore& candidates, size_t j,
+                double* times) {
+    const __m256d vx = _mm256_loadu_pd(&candidates.vx[j]);
+    const __m256d vy = _mm256_loadu_pd(&candidates.vy[j]);
+    const __m256d dt = _mm256_sub_pd(t, _mm256_loadu_pd(&candidates.time[j]));
+    const __m256d rx = _mm256_add_pd(_mm256_loadu_pd(&candidates.rx[j]), _mm256_mul_pd(vx, dt));
+    const __m256d ry = _mm256_add_pd(_mm256_loadu_pd(&candidates.ry[j]), _mm256_mul_pd(vy, dt));
+
+    const __m256d drx = _mm256_sub_pd(rx, _mm256_set1_pd(particle.r.x));
+    const __m256d dry = _mm256_sub_pd(ry, _mm256_set1_pd(particle.r.y));
+    const __m256d dvx = _mm256_sub_pd(vx, _mm256_set1_pd(particle.v.x));
+    const __m256d dvy = _mm256_sub_pd(vy, _mm256_set1_pd(particle.v.y));
+
+    const __m256d dvdr = _mm256_add_pd(_mm256_mul_pd(drx, dvx), _mm256_mul_pd(dry, dvy));
+    const __m256d dvdv = _mm256_add_pd(_mm256_mul_pd(dvx, dvx), _mm256_mul_pd(dvy, dvy));
+    const __m256d drdr = _mm256_add_pd(_mm256_mul_pd(drx, drx), _mm256_mul_pd(dry, dry));
+    const __m256d sigma =
+        _mm256_add_pd(_mm256_set1_pd(particle.radius), _mm256_loadu_pd(&candidates.radius[j]));
+    const __m256d sigma2 = _mm256_mul_pd(sigma, sigma);
+
+    const __m256d d = _mm256_sub_pd(_mm256_mul_pd(dvdr, dvdr),
+                                    _mm256_mul_pd(dvdv, _mm256_sub_pd(drdr, sigma2)));
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d sum = _mm256_add_pd(dvdr, _mm256_sqrt_pd(d));
+    const __m256d time = _mm256_div_pd(sum, _mm256_sub_pd(zero, dvdv));  // -sum / dvdv
+
+    __m256d miss = _mm256_cmp_pd(dvdr, zero, _CMP_GT_OQ);
+    miss = _mm256_or_pd(miss, _mm256_cmp_pd(dvdv, zero, _CMP_EQ_OQ));
+    miss = _mm256_or_pd(miss, _mm256_cmp_pd(drdr, sigma2, _CMP_LT_OQ));
+    miss = _mm256_or_pd(miss, _mm256_cmp_pd(d, zero, _CMP_LT_OQ));
+    miss = _mm256_or_pd(miss, _mm256_cmp_pd(time, zero, _CMP_LT_OQ));
+
+    _mm256_storeu_pd(times, _mm256_blendv_pd(time, _mm256_set1_pd(infinity), miss));
+}
+
+#endif
+
+}  // namespace
+
+/**
+ * Constructor to create a store with the trajectories of the given particles
+ */
+ParticleStore::ParticleStore(std::span<const Particle> particles) {
+    for (const auto& p : particles) {
+        push_back(p);
+    }
+}
+
+/**
+ * Remove all entries, the memory is kept for reuse
+ */
+void ParticleStore::clear() {
+    rx.clear();
+    ry.clear();
+    vx.clear();
+    vy.clear();
+    radius.clear();
+    time.clear();
+}
+
+/**
+ * Add the trajectory of particle p as the last entry
+ */
+void ParticleStore::push_back(const Particle& p) {
+    rx.push_back(p.r.x);
+    ry.push_back(p.r.y);
+    vx.push_back(p.v.x);
+    vy.push_back(p.v.y);
+    radius.push_back(p.radius);
+    time.push_back(p.time);
+}
+
+/**
+ * Add a copy of entry i of store from as the last entry
+ */
+void ParticleStore::append(const ParticleStore& from, size_t i) {
+    rx.push_back(from.rx[i]);
+    ry.push_back(from.ry[i]);
+    vx.push_back(from.vx[i]);
+    vy.push_back(from.vy[i]);
+    radius.push_back(from.radius[i]);
+    time.push_back(from.time[i]);
+}
+
+/**
+ * Replace entry i by the trajectory of particle p
+ */
+void ParticleStore::set(size_t i, const Particle& p) {
+    rx[i] = p.r.x;
+    ry[i] = p.r.y;
+    vx[i] = p.v.x;
+    vy[i] = p.v.y;
+    radius[i] = p.radius;
+    time[i] = p.time;
+}
+
+/**
+ * Replace entry i by a copy of entry j of store from
+ */
+void ParticleStore::set(size_t i, const ParticleStore& from, size_t j) {
+    rx[i] = from.rx[j];
+    ry[i] = from.ry[j];
+    vx[i] = from.vx[j];
+    vy[i] = from.vy[j];
+    radius[i] = from.radius[j];
+    time[i] = from.time[j];
+}
+
+/**
+ * Compute, for every entry j = first, first+1, ..., first+times.size()-1 of candidates, the
+ * amount of time for particle to collide with the particle of entry j
+ */
+void timeToHit(const Particle& particle, double t, const ParticleStore& candidates, size_t first,
+               std::span<double> times) {
+    assert(particle.time == t && first + times.size() <= candidates.size());
+
+    const size_t last = first + times.size();
+    size_t j = first;
+#if defined(__AVX512F__)
+    const __m512d t8 = _mm512_set1_pd(t);
+    for (; j + 8 <= last; j += 8) {
+        timeToHit8(particle, t8, candidates, j, &times[j - first]);
+    }
+#elif defined(__AVX2__)
+    const __m256d t4 = _mm256_set1_pd(t);
+    for (; j + 4 <= last; j += 4) {
+        timeToHit4(particle, t4, candidates, j, &times[j - first]);
+    }
+#endif
+    for (; j < last; ++j) {  // remaining candidates
+        times[j - first] = timeToHitScalar(particle, t, candidates, j);
+    }
+}
+
+}  // namespace particlesystem
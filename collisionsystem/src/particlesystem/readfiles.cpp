@@ -0,0 +1,56 @@
+#include <particlesystem/readfiles.h>
+#include <particlesystem/particlefile.h>
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace particlesystem {
+
+/**
+ * Read particles for the simulation from file
+ */
+std::vector<Particle> read_particles(const std::filesystem::path& file) {
+    std::ifstream is(file);
+    if (!is) {
+        return {};
+    }
+    if (ParticleFile::isParticleFile(file)) {
+        return ParticleFile{file}.particles();
+    }
+
+    int n_particles;
+    if (!(is >> n_particles) || n_particles < 0) {  // read number of particles
+        throw std::runtime_error(fmt::format("Invalid number of particles in {}", file.string()));
+    }
+
+    // each particle takes at least 18 characters, do not reserve for more than the file holds
+    std::error_code ec;
+    const std::uintmax_t fits = std::filesystem::file_size(file, ec) / 18;  // huge on error
+    std::vector<Particle> particles;
+    particles.reserve(static_cast<size_t>(std::min<std::uintmax_t>(n_particles, fits)));
+
+    double rx, ry;
+    double vx, vy;
+    double radius;
+    double mass;
+    float r, g, b;
+    for (int i = 0; i < n_particles; ++i) {
+        is >> rx >> ry >> vx >> vy;
+        is >> radius >> mass;
+        is >> r >> g >> b;
+        if (!is) {
+            throw std::runtime_error(fmt::format("{} holds {} particles, expected {}",
+                                                 file.string(), i, n_particles));
+        }
+        particles.push_back(Particle{.r = {rx, ry},
+                                     .v = {vx, vy},
+                                     .radius = radius,
+                                     .mass = mass,
+                                     .color = {r / 255.0f, g / 255.0f, b / 255.0f}});
+    }
+    return particles;
+}
+
+}  // namespace particlesystem
@@ -0,0 +1,27 @@
+#include <particlesystem/snapshot.h>
+
+#include <glm/packing.hpp>
+#include <glm/vec4.hpp>
+
+namespace particlesystem {
+
+/**
+ * Replace the contents by the particles, at simulation time t
+ */
+void Snapshot::assign(double t, std::span<const Particle> particles) {
+    time = t;
+    x.resize(particles.size());
+    y.resize(particles.size());
+    radius.resize(particles.size());
+    color.resize(particles.size());
+
+    for (std::size_t i = 0; i < particles.size(); ++i) {
+        const Particle& p = particles[i];
+        x[i] = static_cast<float>(p.r.x);
+        y[i] = static_cast<float>(p.r.y);
+        radius[i] = static_cast<float>(p.radius);
+        color[i] = glm::packUnorm4x8(glm::vec4{p.color, 1.0f});
+    }
+}
+
+}  // namespace particlesystem
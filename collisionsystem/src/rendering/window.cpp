@@ -20,29 +20,48 @@
 // all documented so that looking at the source code should not be necessary.
 // Having said that, if you are interested in anything, of course continue browsing here
 
-constexpr size_t VBO_CAP = 1024 * 1024;
+// Points are streamed to the GPU in chunks of CHUNK_POINTS points. The vertex buffer is a ring
+// of RING_CHUNKS chunks, so the CPU can fill a chunk while the GPU still draws the previous ones
+constexpr size_t CHUNK_POINTS = 256 * 1024;
+constexpr size_t RING_CHUNKS = 8;
+
+namespace {
+
+// This structure represents how the points is stored in the vertex buffer
+struct Point {
+    glm::vec2 position;
+    float scale;
+    uint32_t color_packed;
+};
+
+}  // namespace
 
 // Internal definition of window implementation
 struct rendering::Window::Impl {
     Impl(int width, int height, UseVSync sync);
     ~Impl();
 
+    // Streams count points to the GPU and draws them, one chunk at a time. For each chunk,
+    // fill(points, first, n) must write the points first, ..., first+n-1 to points[0, n)
+    template <class Fill>
+    void drawPoints(size_t count, Fill fill);
+
     GLFWwindow* window;
 
     GLuint program;
     GLuint vao;
     GLuint vbo;
+
+    // With OpenGL 4.4, the vertex buffer is mapped once for the lifetime of the window and
+    // each chunk of the ring is guarded by a fence, until the GPU has drawn it. Otherwise
+    // mapped is null and every chunk orphans the buffer, which is one chunk long.
+    Point* mapped;
+    std::array<GLsync, RING_CHUNKS> fences;
+    size_t nextChunk;
 };
 
 namespace {
 
-// This structure represents how the points is stored in the vertex buffer
-struct Point {
-    glm::vec2 position;
-    float scale;
-    uint32_t color_packed;
-};
-
 /**
  * Checks the compilation status of the shader passed into it and prints out a message in
  * case the shader was not compiled successfully. If the shader is successfully compiled,
@@ -198,7 +217,7 @@ GLuint createPointProgram() {
 namespace rendering {
 
 Window::Impl::Impl(int width, int height, UseVSync sync)
-    : window{nullptr}, program{0}, vao{0}, vbo{0} {
+    : window{nullptr}, program{0}, vao{0}, vbo{0}, mapped{nullptr}, fences{}, nextChunk{0} {
 
     // Initialize GLFW for window handling
     if (glfwInit() != GLFW_TRUE) {
@@ -224,9 +243,22 @@ Window::Impl::Impl(int width, int height, UseVSync sync)
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
 
-    // Allocate vertex buffer memory
+    // Allocate vertex buffer memory, persistently mapped if supported
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, VBO_CAP * sizeof(Point), nullptr, GL_DYNAMIC_DRAW);
+#ifdef GL_VERSION_4_4
+    if (GLAD_GL_VERSION_4_4) {
+        constexpr GLsizeiptr size = RING_CHUNKS * CHUNK_POINTS * sizeof(Point);
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        mapped = static_cast<Point*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        if (!mapped) {
+            throw std::runtime_error("Failed to map buffer");
+        }
+    }
+#endif
+    if (!mapped) {
+        glBufferData(GL_ARRAY_BUFFER, CHUNK_POINTS * sizeof(Point), nullptr, GL_STREAM_DRAW);
+    }
 
     // Setup vertex attribute pointers for Points
     glBindVertexArray(vao);
@@ -250,6 +282,9 @@ Window::Impl::Impl(int width, int height, UseVSync sync)
 }
 
 Window::Impl::~Impl() {
+    for (GLsync fence : fences) {
+        glDeleteSync(fence);
+    }
     glDeleteProgram(program);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
@@ -296,37 +331,90 @@ void Window::clear(glm::vec4 color) {
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
-void Window::drawParticles(std::span<particlesystem::Particle> particles) {
-
-    if (particles.size() > VBO_CAP) {
-        throw std::runtime_error("Too many rectangles to draw in a single call");
+template <class Fill>
+void Window::Impl::drawPoints(size_t count, Fill fill) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindVertexArray(vao);
+    glUseProgram(program);
+
+    for (size_t first = 0; first < count; first += CHUNK_POINTS) {
+        const size_t n = std::min(count - first, CHUNK_POINTS);
+
+        if (mapped) {
+            // Reuse the oldest chunk of the ring, after the GPU has finished drawing it (which
+            // normally happened frames ago)
+            const size_t chunk = nextChunk;
+            nextChunk = (nextChunk + 1) % RING_CHUNKS;
+            if (GLsync& fence = fences[chunk]; fence) {
+                GLenum status;
+                do {
+                    status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                } while (status == GL_TIMEOUT_EXPIRED);
+                glDeleteSync(fence);
+                fence = nullptr;
+                if (status == GL_WAIT_FAILED) {
+                    throw std::runtime_error("Failed to wait for the GPU");
+                }
+            }
+
+            // The mapping is coherent, so the writes are visible to the draw call
+            fill(mapped + chunk * CHUNK_POINTS, first, n);
+            glDrawArrays(GL_POINTS, static_cast<int>(chunk * CHUNK_POINTS), static_cast<int>(n));
+            fences[chunk] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        } else {
+            // Orphan the buffer, so the GPU can still draw from the previous storage
+            glBufferData(GL_ARRAY_BUFFER, CHUNK_POINTS * sizeof(Point), nullptr, GL_STREAM_DRAW);
+            Point* point_data = static_cast<Point*>(glMapBufferRange(
+                GL_ARRAY_BUFFER, 0, n * sizeof(Point),
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+            if (!point_data) {
+                throw std::runtime_error("Failed to map buffer");
+            }
+            fill(point_data, first, n);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glDrawArrays(GL_POINTS, 0, static_cast<int>(n));
+        }
     }
 
+    glUseProgram(0);
+    glBindVertexArray(0);
+
+    checkOpenGLError("drawPoint");
+}
+
+void Window::drawParticles(std::span<particlesystem::Particle> particles) {
+
     int width, height;
     glfwGetFramebufferSize(impl->window, &width, &height);
 
-    // Upload the passed particle information to the GPU
-    glBindBuffer(GL_ARRAY_BUFFER, impl->vbo);
-    Point* point_data = static_cast<Point*>(glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY));
-    if (point_data) {
-        for (size_t i = 0; auto& p : particles) {
-            point_data[i].position = static_cast<glm::vec2>(2.0 * (p.r - glm::dvec2{0.5f}));
-            point_data[i].scale = static_cast<float>(p.radius * width * 2.0);
-            point_data[i].color_packed = glm::packUnorm4x8(glm::vec4{p.color, 1.0f});
-            ++i;
+    impl->drawPoints(particles.size(), [&](Point* point_data, size_t first, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            const auto& p = particles[first + i];
+            point_data[i] = {static_cast<glm::vec2>(2.0 * (p.r - glm::dvec2{0.5f})),
+                             static_cast<float>(p.radius * width * 2.0),
+                             glm::packUnorm4x8(glm::vec4{p.color, 1.0f})};
         }
-        glUnmapBuffer(GL_ARRAY_BUFFER);
-    } else {
-        throw std::runtime_error("Failed to map buffer");
-    }
+    });
+}
 
-    glBindVertexArray(impl->vao);
-    glUseProgram(impl->program);
-    glDrawArrays(GL_POINTS, 0, static_cast<int>(particles.size()));
-    glUseProgram(0);
-    glBindVertexArray(0);
+void Window::drawParticles(const particlesystem::Snapshot& snapshot) {
 
-    checkOpenGLError("drawPoint");
+    int width, height;
+    glfwGetFramebufferSize(impl->window, &width, &height);
+    const float pixels = 2.0f * static_cast<float>(width);
+
+    // The colors are already packed, so each point is a few arithmetic operations on the
+    // snapshot arrays, written to the (write-combined) buffer in one go
+    impl->drawPoints(snapshot.size(), [&](Point* point_data, size_t first, size_t n) {
+        const float* x = snapshot.x.data() + first;
+        const float* y = snapshot.y.data() + first;
+        const float* radius = snapshot.radius.data() + first;
+        const uint32_t* color = snapshot.color.data() + first;
+        for (size_t i = 0; i < n; ++i) {
+            point_data[i] = {{2.0f * x[i] - 1.0f, 2.0f * y[i] - 1.0f}, radius[i] * pixels,
+                             color[i]};
+        }
+    });
 }
 
 void Window::endFrame() {
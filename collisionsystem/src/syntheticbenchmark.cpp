@@ -0,0 +1,221 @@
+#include <vector>
+#include <string>
+#include <string_view>
+#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <exception>
+
+#include <particlesystem/particle.h>
+#include <particlesystem/collisionsystem.h>
+#include <particlesystem/generator.h>
+
+#include <fmt/format.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace particlesystem;
+
+/*
+ * Benchmark of the collision system on generated particle systems, as a regression baseline
+ * for performance changes
+ * Usage: syntheticbenchmark [key=value ...], with the keys (and defaults)
+ *   n=1000 density=0.1 seed=1 speed=0.01          see GeneratorOptions
+ *   radius=constant|uniform|lognormal             radius distribution (constant)
+ *   radius-spread=0                               its relative spread
+ *   mass=constant|uniform|lognormal|area          mass distribution, area for masses
+ *   mass-spread=0                                 proportional to the area (constant)
+ *   time=10                                       simulation time
+ *   neighborhood=allpairs|celllist                (celllist)
+ *   scheduling=allevents|oneperparticle|parallel  (allevents)
+ *   queue=binaryheap|calendar                     (binaryheap)
+ *   threads=0                                     threads of scheduling=parallel
+ *   runs=1                                        number of simulations of the same system
+ *
+ * Each run prints one JSON object on a line: the parameters, the number of events, events per
+ * second, nanoseconds per event, the largest queue size and the peak resident memory of the
+ * process so far. The particles are rendered once, at time zero, and not drawn.
+ */
+
+/**
+ * Parameters of a benchmark run, by key
+ */
+using Parameters = std::map<std::string, std::string, std::less<>>;
+
+/**
+ * Parse the key=value arguments, on top of the defaults
+ * \throw std::runtime_error for an argument without '=' or an unknown key
+ */
+Parameters parseParameters(int argc, char* argv[]);
+
+/**
+ * Generator options of the parameters
+ */
+GeneratorOptions generatorOptions(const Parameters& parameters);
+
+/**
+ * Simulation options of the parameters
+ */
+CollisionSystem::Options simulationOptions(const Parameters& parameters);
+
+/**
+ * Return the peak resident memory of the process in bytes
+ */
+std::size_t peakResidentBytes();
+
+int main(int argc, char* argv[]) {
+    try {
+        const Parameters parameters = parseParameters(argc, argv);
+        const auto particles = generate_particles(generatorOptions(parameters));
+        const double simulationTime = std::stod(parameters.at("time"));
+        const int runs = std::stoi(parameters.at("runs"));
+
+        std::string config;
+        for (const auto& [key, value] : parameters) {
+            config += fmt::format("\"{}\": \"{}\", ", key, value);
+        }
+
+        for (int run = 0; run < runs; ++run) {
+            CollisionSystem system{particles, simulationOptions(parameters)};
+            system.simulate(simulationTime, 1.0 / simulationTime);  // render only at time zero
+
+            const auto& stats = system.statistics();
+            fmt::print(
+                "{{{}\"run\": {}, \"events\": {}, \"staleEvents\": {}, \"seconds\": {}, "
+                "\"eventsPerSecond\": {}, \"nsPerEvent\": {}, \"peakQueueSize\": {}, "
+                "\"peakRssBytes\": {}}}\n",
+                config, run, stats.eventsProcessed, stats.staleEvents, stats.totalSeconds,
+                stats.eventsPerSecond(),
+                stats.eventsProcessed > 0 ? stats.totalSeconds * 1e9 / stats.eventsProcessed : 0.0,
+                stats.peakQueueSize, peakResidentBytes());
+        }
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "Error: {}\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Parse the key=value arguments, on top of the defaults
+ */
+Parameters parseParameters(int argc, char* argv[]) {
+    Parameters parameters{{"n", "1000"},
+                          {"density", "0.1"},
+                          {"seed", "1"},
+                          {"speed", "0.01"},
+                          {"radius", "constant"},
+                          {"radius-spread", "0"},
+                          {"mass", "constant"},
+                          {"mass-spread", "0"},
+                          {"time", "10"},
+                          {"neighborhood", "celllist"},
+                          {"scheduling", "allevents"},
+                          {"queue", "binaryheap"},
+                          {"threads", "0"},
+                          {"runs", "1"}};
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        const auto equals = argument.find('=');
+        if (equals == std::string_view::npos) {
+            throw std::runtime_error(fmt::format("Expected key=value, got {}", argument));
+        }
+        const auto it = parameters.find(argument.substr(0, equals));
+        if (it == parameters.end()) {
+            throw std::runtime_error(
+                fmt::format("Unknown parameter {}", argument.substr(0, equals)));
+        }
+        it->second = argument.substr(equals + 1);
+    }
+    return parameters;
+}
+
+/**
+ * Help function to return the enumerator named by parameter key
+ * \throw std::runtime_error if the value is not one of the names
+ */
+template <class Enum>
+Enum choose(const Parameters& parameters, std::string_view key,
+            std::initializer_list<std::pair<std::string_view, Enum>> choices) {
+    const std::string& value = parameters.find(key)->second;
+    for (const auto& [name, e] : choices) {
+        if (value == name) return e;
+    }
+    throw std::runtime_error(fmt::format("Unknown {} {}", key, value));
+}
+
+/**
+ * Generator options of the parameters
+ */
+GeneratorOptions generatorOptions(const Parameters& parameters) {
+    using Kind = Distribution::Kind;
+    const std::initializer_list<std::pair<std::string_view, Kind>> kinds = {
+        {"constant", Kind::Constant}, {"uniform", Kind::Uniform}, {"lognormal", Kind::LogNormal}};
+
+    GeneratorOptions options;
+    options.count = std::stoull(parameters.at("n"));
+    options.density = std::stod(parameters.at("density"));
+    options.seed = std::stoull(parameters.at("seed"));
+    options.speed = std::stod(parameters.at("speed"));
+    options.radius.kind = choose(parameters, "radius", kinds);
+    options.radius.spread = std::stod(parameters.at("radius-spread"));
+
+    options.massFromArea = parameters.at("mass") == "area";
+    if (!options.massFromArea) {
+        options.mass.kind = choose(parameters, "mass", kinds);
+    }
+    options.mass.spread = std::stod(parameters.at("mass-spread"));
+    return options;
+}
+
+/**
+ * Simulation options of the parameters
+ */
+CollisionSystem::Options simulationOptions(const Parameters& parameters) {
+    using Neighborhood = CollisionSystem::Neighborhood;
+    using Scheduling = CollisionSystem::Scheduling;
+    using QueueBackend = CollisionSystem::QueueBackend;
+
+    CollisionSystem::Options options;
+    options.neighborhood = choose<Neighborhood>(
+        parameters, "neighborhood",
+        {{"allpairs", Neighborhood::AllPairs}, {"celllist", Neighborhood::CellList}});
+    options.scheduling = choose<Scheduling>(parameters, "scheduling",
+                                            {{"allevents", Scheduling::AllEvents},
+                                             {"oneperparticle", Scheduling::OnePerParticle},
+                                             {"parallel", Scheduling::Parallel}});
+    options.queue = choose<QueueBackend>(
+        parameters, "queue",
+        {{"binaryheap", QueueBackend::BinaryHeap}, {"calendar", QueueBackend::Calendar}});
+    options.threads = static_cast<unsigned>(std::stoul(parameters.at("threads")));
+    options.printProgress = false;
+    return options;
+}
+
+/**
+ * Return the peak resident memory of the process in bytes
+ */
+std::size_t peakResidentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);  // in bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;  // in kilobytes
+#endif
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <filesystem>
+
+#include <linesdiscoverysystem/point.h>
+
+/*
+ * A maximal line segment through 4 or more collinear points
+ * Holds all points on the segment in increasing order, so the segment goes from the first to
+ * the last point
+ */
+struct Segment {
+    std::vector<Point> points;
+
+    //segments are ordered lexicographically by their points
+    bool operator<(const Segment& s) const;
+};
+
+/*
+ * Finds all maximal line segments through 4 or more of the points
+ * Each segment is only emitted from its smallest point, thus each segment is found once: for
+ * each anchor point, all other points are sorted by the slope of their line through the anchor,
+ * so that the points on a line through the anchor form a run of equal slopes, emitted if the
+ * anchor is smaller than all of them. Slopes are exact integer keys
+ * (a fixed-point pseudo-angle), sorted by a radix sort. O(N^2) time, O(N) memory besides the
+ * segments
+ * The anchors are divided among the given number of threads, 0 for one per hardware thread.
+ * Each thread collects its segments separately, the result does not depend on the number of
+ * threads
+ * Returns the segments in increasing order
+ */
+std::vector<Segment> find_segments(std::vector<Point> points, unsigned threads = 0);
+
+//memory used by find_segments_out_of_core unless given
+constexpr std::size_t default_memory_limit = std::size_t{1} << 30;
+
+/*
+ * Finds all maximal line segments through 4 or more of the points in a points file, like
+ * find_segments, for point sets larger than memory. Besides the points of a single segment,
+ * about memory_limit bytes are used, the points themselves are read from memory-mapped files:
+ * - the file is converted to its binary copy (see cache_points) and sorted by an external merge
+ *   sort into a temporary file, runs of memory_limit bytes at a time
+ * - the anchors are processed in blocks, each against all points in chunks of the mapped file.
+ *   If the slopes of a block do not fit in memory, they are spilled to temporary files by a
+ *   hash of the line, and each file is read back and grouped on its own. A line is emitted if
+ *   the anchor is smaller than all other points in its group, so no other part of the file is
+ *   read to check it
+ * The segments of a block start at its anchors, so they are sorted per block and passed to
+ * output in increasing order, without being held until the end
+ * Temporary files go to a new directory in temp_dir, removed when done
+ * Throws std::runtime_error if the file cannot be read or the temporary files cannot be written
+ */
+void find_segments_out_of_core(
+    const std::filesystem::path& file, const std::function<void(const Segment&)>& output,
+    std::size_t memory_limit = default_memory_limit,
+    const std::filesystem::path& temp_dir = std::filesystem::temp_directory_path());
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <cstddef>
+#include <filesystem>
+
+/*
+ * A file mapped read-only into memory
+ * The contents are loaded by the operating system when accessed, nothing is copied
+ */
+class MappedFile {
+public:
+    /*
+     * Maps the given file
+     * Throws std::runtime_error if the file cannot be opened or mapped
+     */
+    explicit MappedFile(const std::filesystem::path& file);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /*
+     * Returns the contents of the file
+     */
+    std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+private:
+    //unmaps the file, if mapped
+    void unmap();
+
+    const std::byte* data_ = nullptr;  //start of the mapping, null for an empty file
+    std::size_t size_ = 0;             //size of the file in bytes
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+ * A point of the input, the coordinates are integers in [0, 32767], so that slopes between
+ * points can be compared exactly
+ */
+//largest coordinate of a point, the smallest is 0
+constexpr int max_coordinate = 32767;
+
+struct Point {
+    int x{0};
+    int y{0};
+
+    bool operator==(const Point& p) const = default;
+
+    //comparison operator for points
+    bool operator<(const Point& p) const {
+        if (x != p.x) {
+            return x < p.x;
+        }
+        return y < p.y;
+    }
+};
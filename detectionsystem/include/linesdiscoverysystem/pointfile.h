@@ -0,0 +1,89 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+
+#include <linesdiscoverysystem/point.h>
+#include <linesdiscoverysystem/mappedfile.h>
+
+/*
+ * Reads all points from a points file: the number of points followed by the x and y
+ * coordinates of each point, all integers in [0, max_coordinate] separated by white space
+ * The file is memory-mapped and parsed in place with std::from_chars. A binary copy of the
+ * points is written next to the file (see point_cache_path), which is read instead, without
+ * parsing, as long as it is newer than the file
+ * Throws std::runtime_error if the file cannot be read or is malformed
+ */
+std::vector<Point> load_points(const std::filesystem::path& file);
+
+/*
+ * Returns the path of the binary copy of a points file: the file name followed by ".bin"
+ */
+std::filesystem::path point_cache_path(const std::filesystem::path& file);
+
+/*
+ * Makes sure the binary copy of a points file is up to date, like load_points, but without
+ * holding all points in memory: the file is parsed and written in blocks
+ * Returns the path of the binary copy, to be read with MappedPoints
+ * Throws std::runtime_error if the file cannot be read or is malformed, or the copy cannot be
+ * written
+ */
+std::filesystem::path cache_points(const std::filesystem::path& file);
+
+/*
+ * The points of a binary points file, e.g. a binary copy of a points file, mapped into memory
+ * Points are copied out one at a time, only the parts of the file in use are loaded
+ */
+class MappedPoints {
+public:
+    /*
+     * Maps the given binary points file
+     * Throws std::runtime_error if the file cannot be mapped or is no binary points file
+     */
+    explicit MappedPoints(const std::filesystem::path& file);
+
+    std::size_t size() const { return size_; }
+
+    Point operator[](std::size_t i) const {
+        Point p;
+        std::memcpy(&p, points_ + i * sizeof(Point), sizeof(Point));
+        return p;
+    }
+
+private:
+    MappedFile file_;
+    const std::byte* points_ = nullptr;  //first point in the mapping
+    std::size_t size_ = 0;               //number of points
+};
+
+/*
+ * Writes a binary points file, in blocks of points
+ * The file is only valid once closed, so a file that is not completely written is never read
+ */
+class PointWriter {
+public:
+    /*
+     * Creates the given file
+     * Throws std::runtime_error if the file cannot be created
+     */
+    explicit PointWriter(const std::filesystem::path& file);
+
+    //appends the points to the file
+    void write(std::span<const Point> points);
+
+    /*
+     * Completes the file
+     * Throws std::runtime_error if the file could not be written
+     */
+    void close();
+
+private:
+    std::filesystem::path file_;
+    std::ofstream out_;
+    std::uint64_t count_ = 0;  //number of points written
+};
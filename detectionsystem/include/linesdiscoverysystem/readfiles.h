@@ -2,8 +2,10 @@
 
 #include <iostream>
 #include <vector>
+#include <span>
 #include <filesystem>
 
+#include <linesdiscoverysystem/point.h>
 #include <rendering/window.h>
 
 #include <fmt/format.h>
@@ -23,3 +25,8 @@ std::vector<rendering::Point> readLineSegments(const std::filesystem::path& file
 * Returns a vector of points that can be rendered
 */
 std::vector<rendering::Point> readPoints(const std::filesystem::path& file);
+
+/*
+* Converts points, e.g. as read by load_points, to points that can be rendered
+*/
+std::vector<rendering::Point> readPoints(std::span<const Point> points);
@@ -1,4 +1,6 @@
 #include <linesdiscoverysystem/readfiles.h>  //read points function -> given
+#include <linesdiscoverysystem/collinear.h>  //segments of collinear points
+#include <linesdiscoverysystem/pointfile.h>  //fast points file reading
 
 #include <vector>
 #include <string>
@@ -7,40 +9,24 @@
 #include <fstream>    //file reading and writing
 #include <algorithm>  //sort
 #include <vector>
-#include <unordered_map>  //unordered map
-#include <set>            //set
 
 #include <rendering/window.h>
 #include <fmt/format.h>
 
-//structs allow public members by default - create class for points
-struct Point {
-    double x{0.0};
-    double y{0.0};
-
-    //comparison operator for points
-    bool operator<(const Point& p) const {
-        if (x != p.x) {
-            return x < p.x;
-        }
-        return y < p.y;
-    }
-};
-
-//compute slopes function
-double compute_slope(const Point& p1, const Point& p2);
-
 //compute collinear points
 void find_collinears(const std::vector<Point>& points, const std::string& file_name);
 
+//compute collinear points of a points file too large for memory, writing them as found
+void find_collinears_out_of_core(const std::string& file_name);
+
 //print collienar points segments
-void print_collinear(const std::set<std::set<Point>>& segments); 
+void print_collinear(const std::vector<Segment>& segments);
 
-void plotData(const std::string& name);
+void plotData(const std::string& name, const std::vector<Point>& input);
 
 //file handling
 std::vector<Point> read_points_file(const std::string& file);
-void write_to_file(const std::set<std::set<Point>>& lines, const std::string& file_name);
+void write_to_file(const std::vector<Segment>& lines, const std::string& file_name);
 
 /* ************************************* */
 
@@ -50,12 +36,18 @@ int main() {
         std::string s;
         std::cin >> s;  // e.g. points1.txt, points200.txt, largeMystery.txt
 
+        //too many points to hold, or to print and plot: only write the segments
+        if (std::filesystem::file_size(data_dir / s) > default_memory_limit) {
+            find_collinears_out_of_core(s);
+            return 0;
+        }
+
         //read points from file
         std::vector<Point> the_points = read_points_file(s);
         //compute, print and write to file the collinear points segments 
         find_collinears(the_points, s);
 
-        plotData(s);
+        plotData(s, the_points);
     } catch (const std::exception& e) {
         fmt::print("Error: {}", e.what());
         return 1;
@@ -64,9 +56,8 @@ int main() {
 
 /* ************************************* */
 
-void plotData(const std::string& name) {
-    std::filesystem::path points_name = name;
-    const auto points = readPoints(data_dir / points_name);
+void plotData(const std::string& name, const std::vector<Point>& input) {
+    const auto points = readPoints(input);  //the points already read, not the file again
 
     std::filesystem::path segments_name = "segments-" + name;
     const auto lines = readLineSegments(data_dir / "output" / segments_name);
@@ -88,39 +79,14 @@ void plotData(const std::string& name) {
 //file handling
 std::vector<Point> read_points_file(const std::string& file) {
 
-    //vector to store points
-    std::vector<Point> points{};
-
     //create a file path system from the data folder
     std::filesystem::path points_file = data_dir / file;
 
-    //input stream for file reading
-    std::ifstream file_reader(points_file);
-
-    //read file, if not possible return error message
-    if (!file_reader) {
-        std::cout << "error reading file!\n";
-        return {};
-    }
-
-    //read first line = number of points
-    int n_points = 0;
-    file_reader >> n_points;
-
-    //reserve vector for points in file
-    points.reserve(n_points);
-
-    //read the rest of the points
-    for (int i = 0; i < n_points; ++i) {
-        Point current_point = Point{};
-        auto& the_point = points.emplace_back(current_point);
-        file_reader >> the_point.x >> the_point.y;
-    }
-
-    return points;
+    //parse the file once, or read its binary copy from an earlier run
+    return load_points(points_file);
 }
 
-void write_to_file(const std::set<std::set<Point>>& lines, const std::string& file_name) {
+void write_to_file(const std::vector<Segment>& lines, const std::string& file_name) {
 
     //set up file path to output directory
     std::string output_dir = "output";
@@ -137,13 +103,9 @@ void write_to_file(const std::set<std::set<Point>>& lines, const std::string& fi
     }
 
     for (const auto& line : lines) {
-        // convert the set to a vector and sort to determine endpoints
-        std::vector<Point> sortedPoints(line.begin(), line.end());
-        std::stable_sort(sortedPoints.begin(), sortedPoints.end());
-
-        // assuming the first and last are the start and endpoints
-        Point startPoint = sortedPoints.front();
-        Point endPoint = sortedPoints.back();
+        // the points of a segment are sorted, the first and last are the start and endpoints
+        Point startPoint = line.points.front();
+        Point endPoint = line.points.back();
 
         file_writer << startPoint.x << " " << startPoint.y << " " << endPoint.x << " " << endPoint.y
                     << std::endl;
@@ -151,24 +113,12 @@ void write_to_file(const std::set<std::set<Point>>& lines, const std::string& fi
     file_writer.close();
 }
 
-//compute slopes function
-double compute_slope(const Point& p1, const Point& p2) {
-
-    //if lines are vertical, division by 0 not allowed
-    if (p1.x == p2.x) {
-        return std::numeric_limits<double>::infinity();
-    }
-
-    //compute the slope
-    return (p2.y - p1.y) / (p2.x - p1.x);
-}
-
-
 //print collienar points segments
-void print_collinear(const std::set<std::set<Point>>& segments) {
+void print_collinear(const std::vector<Segment>& segments) {
 
     //print points on segments 
-    for (const auto& seg : segments) {
+    for (const auto& segment : segments) {
+        const auto& seg = segment.points;
 
         //iterators to start and end of each segment seg
         auto seg_start_it = seg.begin(); 
@@ -190,38 +140,33 @@ void print_collinear(const std::set<std::set<Point>>& segments) {
 //compute collinear points
 void find_collinears(const std::vector<Point>& points, const std::string& file_name) {
 
-    //map=hash for points and slopes
-    std::set<std::set<Point>> uniqueLines;
-
-    //iterate points vector and compute slope for every point relative to all other points
-    for (std::size_t i = 0; i < points.size(); ++i) {
+    //maximal segments of 4 or more points, each found once, in increasing order
+    const std::vector<Segment> uniqueLines = find_segments(points);
 
-        //map for points and slopes 
-        std::unordered_map<double, std::set<Point>> points_and_slopes;
+    //print collinear points 
+    print_collinear(uniqueLines); 
 
-        for (std::size_t j = 0; j < points.size(); ++j) {
+    //write start- and end points to txt file
+    write_to_file(uniqueLines, file_name);
+}
 
-            //don't compute slope from the same point
-            if (i == j) continue;
+void find_collinears_out_of_core(const std::string& file_name) {
 
-            //compute the slope
-            double slope = compute_slope(points[i], points[j]);
+    //set up file path to output directory
+    std::string name = "segments-" + file_name;
+    std::filesystem::path output_target = data_dir / "output" / name;
 
-            //insert computed slope and the points
-            points_and_slopes[slope].insert(points[i]);
-            points_and_slopes[slope].insert(points[j]);
-        }
-        //insert unique segemnts with 4 or more points 
-        for (const auto& [slope, line] : points_and_slopes) {
-            if (line.size() >= 4) {
-                uniqueLines.insert(line);
-            }
-        }
+    std::ofstream file_writer(output_target);
+    if (!file_writer.is_open()) {
+        std::cout << "Error opening the file for writing!" << std::endl;
+        return;
     }
 
-    //print collinear points 
-    print_collinear(uniqueLines); 
-
-    //write start- and end points to txt file
-    write_to_file(uniqueLines, file_name);
+    //segments arrive in increasing order, write start- and end points of each
+    find_segments_out_of_core(data_dir / file_name, [&](const Segment& segment) {
+        const Point& startPoint = segment.points.front();
+        const Point& endPoint = segment.points.back();
+        file_writer << startPoint.x << " " << startPoint.y << " " << endPoint.x << " "
+                    << endPoint.y << "\n";
+    });
 }
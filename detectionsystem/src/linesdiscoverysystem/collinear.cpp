@@ -0,0 +1,440 @@
+#include <linesdiscoverysystem/collinear.h>
+#include <linesdiscoverysystem/pointfile.h>
+#include <linesdiscoverysystem/mappedfile.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <thread>
+#include <queue>
+#include <random>
+#include <string>
+#include <optional>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+//an item to sort holds the slope key in the high bits and the point index in the low bits
+constexpr int index_bits = 29;
+constexpr int key_bits = 35;
+constexpr std::uint64_t index_mask = (std::uint64_t{1} << index_bits) - 1;
+
+//fractional bits of the slope keys
+constexpr int fraction_bits = 33;
+
+//radix sort digits, and the size below which std::sort is faster
+constexpr int digit_bits = 12;
+constexpr std::uint64_t digit_mask = (std::uint64_t{1} << digit_bits) - 1;
+constexpr std::size_t small_sort = 256;
+
+/*
+ * Exact slope key of the line from p to a larger point q, in key_bits bits
+ * The direction (dx, dy), where dx >= 0 since q is larger, is mapped to the pseudo-angle
+ * t = dy / (dx + |dy|) in [-1, 1], which increases with the slope and needs no special case
+ * for vertical lines. t is a fraction with a denominator of at most 2 * 32767, so different
+ * slopes differ by more than 2^-32 in t, while the rounding error of the division is at most
+ * 2^-54. Hence floor(t * 2^33) is the same integer for points on the same line through p, and
+ * different for points on different lines.
+ * For a smaller point q, slope_key(q, p) is the key of the same line, with the direction from
+ * the smaller to the larger point as well.
+ */
+std::uint64_t slope_key(const Point& p, const Point& q) {
+    const int dx = q.x - p.x;
+    const int dy = q.y - p.y;
+    const double t = static_cast<double>(dy) / (dx + std::abs(dy));  // not 0/0, p != q
+    const auto key = static_cast<std::int64_t>(std::floor(std::ldexp(t, fraction_bits)));
+    return static_cast<std::uint64_t>(key + (std::int64_t{1} << fraction_bits));
+}
+
+/*
+ * Sorts the items by slope key, keeping items with equal keys in index order
+ * LSD radix sort of the key bits, buffer is scratch space
+ */
+void sort_by_key(std::vector<std::uint64_t>& items, std::vector<std::uint64_t>& buffer) {
+    if (items.size() < small_sort) {
+        std::sort(items.begin(), items.end());  //the index breaks ties
+        return;
+    }
+
+    buffer.resize(items.size());
+    std::array<std::size_t, digit_mask + 1> counts;
+    for (int shift = index_bits; shift < index_bits + key_bits; shift += digit_bits) {
+        counts.fill(0);
+        for (const auto item : items) {
+            ++counts[(item >> shift) & digit_mask];
+        }
+        std::exclusive_scan(counts.begin(), counts.end(), counts.begin(), std::size_t{0});
+        for (const auto item : items) {
+            buffer[counts[(item >> shift) & digit_mask]++] = item;
+        }
+        items.swap(buffer);
+    }
+}
+
+/*
+ * Adds the segments whose smallest point is points[i] to segments
+ * slopes and buffer are scratch space
+ */
+void find_from(const std::vector<Point>& points, std::size_t i, std::vector<std::uint64_t>& slopes,
+               std::vector<std::uint64_t>& buffer, std::vector<Segment>& segments) {
+    //all other points, smaller ones with the key of the line from the smaller point, so that a
+    //line through i is one run whatever side of i its points are on
+    slopes.clear();
+    for (std::size_t j = 0; j < i; ++j) {
+        slopes.push_back(slope_key(points[j], points[i]) << index_bits | j);
+    }
+    for (std::size_t j = i + 1; j < points.size(); ++j) {
+        slopes.push_back(slope_key(points[i], points[j]) << index_bits | j);
+    }
+
+    //runs of equal slopes, each run in increasing point order
+    sort_by_key(slopes, buffer);
+
+    for (std::size_t first = 0; first < slopes.size();) {
+        const std::uint64_t key = slopes[first] >> index_bits;
+        std::size_t last = first + 1;
+        while (last < slopes.size() && slopes[last] >> index_bits == key) {
+            ++last;
+        }
+
+        //3 or more points on the line, all larger, i.e. the first is
+        if (last - first >= 3 && (slopes[first] & index_mask) > i) {
+            auto& segment = segments.emplace_back();
+            segment.points.reserve(last - first + 1);
+            segment.points.push_back(points[i]);
+            for (std::size_t k = first; k < last; ++k) {
+                segment.points.push_back(points[slopes[k] & index_mask]);
+            }
+        }
+        first = last;
+    }
+}
+
+/* ************************************* */
+/* Out-of-core detection */
+/* ************************************* */
+
+//points of the mapped file paired with the anchors of a block at a time, see pair_block
+constexpr std::size_t chunk_size = 4096;
+
+//temporary files written at the same time when spilling slopes
+constexpr std::size_t max_spill_files = 256;
+
+//anchors of a block, the local anchor index is stored above the slope key
+constexpr std::size_t max_anchors = std::size_t{1} << (64 - key_bits);
+
+/*
+ * The slope from an anchor of a block to a larger point
+ * Items on the same line through the anchor have the same line, and sort by point
+ */
+struct Item {
+    std::uint64_t line;   //local anchor index in the high bits, slope key in the low key_bits
+    std::uint64_t point;  //index of the larger point
+
+    auto operator<=>(const Item&) const = default;
+};
+
+//spreads lines over the spill files
+std::uint64_t spread(std::uint64_t line) { return (line * 0x9E3779B97F4A7C15u) >> 32; }
+
+//a new temporary directory, removed with its files when destroyed
+struct TempDir {
+    std::filesystem::path path;
+
+    explicit TempDir(const std::filesystem::path& parent) {
+        std::random_device random;
+        do {
+            path = parent / ("linesdiscovery-" + std::to_string(random()));
+        } while (!std::filesystem::create_directories(path));
+    }
+
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+};
+
+/*
+ * Sorts the points into a new binary points file in temp, dropping points given more than once
+ * Runs of memory_limit bytes are sorted in memory and written to disk, then the mapped runs are
+ * merged
+ */
+std::filesystem::path sort_points(const MappedPoints& points, const TempDir& temp,
+                                  std::size_t memory_limit) {
+    const std::size_t run_size = std::max<std::size_t>(memory_limit / sizeof(Point), 1);
+
+    std::vector<std::filesystem::path> runs;
+    {
+        std::vector<Point> run;
+        run.reserve(std::min(run_size, points.size()));
+        for (std::size_t first = 0; first < points.size(); first += run_size) {
+            run.clear();
+            for (std::size_t i = first; i < std::min(first + run_size, points.size()); ++i) {
+                run.push_back(points[i]);
+            }
+            std::sort(run.begin(), run.end());
+            run.erase(std::unique(run.begin(), run.end()), run.end());
+
+            const auto& file = runs.emplace_back(temp.path / ("run" + std::to_string(runs.size())));
+            PointWriter out{file};
+            out.write(run);
+            out.close();
+        }
+    }
+
+    const auto sorted = temp.path / "sorted";
+    {
+        std::vector<MappedPoints> mapped(runs.begin(), runs.end());
+        std::vector<std::size_t> next(runs.size(), 0);
+
+        //smallest point of each run not yet merged, and its run
+        using Head = std::pair<Point, std::size_t>;
+        auto larger = [](const Head& a, const Head& b) { return b.first < a.first; };
+        std::priority_queue<Head, std::vector<Head>, decltype(larger)> heads(larger);
+        for (std::size_t r = 0; r < mapped.size(); ++r) {
+            if (mapped[r].size() > 0) {
+                heads.emplace(mapped[r][0], r);
+            }
+        }
+
+        PointWriter out{sorted};
+        std::optional<Point> last;
+        while (!heads.empty()) {
+            const auto [p, r] = heads.top();
+            heads.pop();
+            if (p != last) {
+                out.write({&p, 1});
+                last = p;
+            }
+            if (++next[r] < mapped[r].size()) {
+                heads.emplace(mapped[r][next[r]], r);
+            }
+        }
+        out.close();
+    }  //unmap the runs
+
+    for (const auto& file : runs) {
+        std::filesystem::remove(file);
+    }
+    return sorted;
+}
+
+/*
+ * Passes the slope of the line from each anchor in [first, last) to each other point to add,
+ * keyed like in find_from
+ * The points are taken in chunks, all anchors of the block are paired with a chunk before the
+ * next chunk, so that each point of the mapped file is read once per block
+ */
+template <typename Add>
+void pair_block(const MappedPoints& points, std::size_t first, std::size_t last, Add add) {
+    for (std::size_t chunk = 0; chunk < points.size(); chunk += chunk_size) {
+        const std::size_t chunk_end = std::min(chunk + chunk_size, points.size());
+        for (std::size_t i = first; i < last; ++i) {
+            const Point p = points[i];
+            const std::uint64_t anchor = std::uint64_t{i - first} << key_bits;
+            for (std::size_t j = chunk; j < std::min(i, chunk_end); ++j) {
+                add(Item{anchor | slope_key(points[j], p), j});
+            }
+            for (std::size_t j = std::max(chunk, i + 1); j < chunk_end; ++j) {
+                add(Item{anchor | slope_key(p, points[j]), j});
+            }
+        }
+    }
+}
+
+/*
+ * Adds the segments given by the items of the anchors from first on to segments, like find_from
+ * All items of a line must be in items
+ */
+void find_lines(const MappedPoints& points, std::size_t first, std::vector<Item>& items,
+                std::vector<Segment>& segments) {
+    std::sort(items.begin(), items.end());
+
+    for (std::size_t begin = 0; begin < items.size();) {
+        std::size_t end = begin + 1;
+        while (end < items.size() && items[end].line == items[begin].line) {
+            ++end;
+        }
+
+        //3 or more points on the line, all larger than the anchor, i.e. the first is
+        const std::size_t i = first + (items[begin].line >> key_bits);
+        if (end - begin >= 3 && items[begin].point > i) {
+            auto& segment = segments.emplace_back();
+            segment.points.reserve(end - begin + 1);
+            segment.points.push_back(points[i]);
+            for (std::size_t k = begin; k < end; ++k) {
+                segment.points.push_back(points[items[k].point]);
+            }
+        }
+        begin = end;
+    }
+}
+
+/*
+ * Adds the segments of the anchors in [first, last) to segments, with the items spilled to
+ * files in temp and grouped a part at a time, at most max_items items in memory
+ */
+void find_lines_spilled(const MappedPoints& points, std::size_t first, std::size_t last,
+                        std::size_t count, std::size_t max_items, const TempDir& temp,
+                        std::vector<Item>& items, std::vector<Segment>& segments) {
+    //twice the parts needed on average, as the lines are not spread evenly
+    const std::size_t parts = 2 * ((count + max_items - 1) / max_items);
+    const std::size_t files = std::min(parts, max_spill_files);
+    const std::size_t passes = (parts + files - 1) / files;  //over each file
+
+    std::vector<std::filesystem::path> paths;
+    {
+        std::vector<std::ofstream> spills;
+        for (std::size_t f = 0; f < files; ++f) {
+            const auto& file = paths.emplace_back(temp.path / ("spill" + std::to_string(f)));
+            spills.emplace_back(file, std::ios::binary | std::ios::trunc);
+        }
+        pair_block(points, first, last, [&](const Item& item) {
+            spills[spread(item.line) % files].write(reinterpret_cast<const char*>(&item),
+                                                    sizeof item);
+        });
+        for (std::size_t f = 0; f < files; ++f) {
+            spills[f].close();
+            if (!spills[f]) {
+                throw std::runtime_error("Unable to write file " + paths[f].string());
+            }
+        }
+    }
+
+    //each line is in one file, and taken in one pass over it
+    for (const auto& file : paths) {
+        const MappedFile mapped{file};
+        const auto bytes = mapped.bytes();
+        for (std::size_t pass = 0; pass < passes; ++pass) {
+            items.clear();
+            for (std::size_t offset = 0; offset < bytes.size(); offset += sizeof(Item)) {
+                Item item;
+                std::memcpy(&item, bytes.data() + offset, sizeof item);
+                if (spread(item.line) / files % passes == pass) {
+                    items.push_back(item);
+                }
+            }
+            find_lines(points, first, items, segments);
+        }
+    }
+
+    for (const auto& file : paths) {
+        std::filesystem::remove(file);
+    }
+}
+
+}  // namespace
+
+bool Segment::operator<(const Segment& s) const {
+    return std::lexicographical_compare(points.begin(), points.end(), s.points.begin(),
+                                        s.points.end());
+}
+
+/*
+ * Finds all maximal line segments through 4 or more of the points
+ * Returns the segments in increasing order, for any number of threads
+ */
+std::vector<Segment> find_segments(std::vector<Point> points, unsigned threads) {
+    constexpr std::size_t chunks_per_thread = 16;  //small chunks balance the uneven work
+
+    //with the points sorted, a point index is smaller exactly when the point is, and a point
+    //given more than once counts once
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    if (points.size() > index_mask) {
+        throw std::length_error("Too many points to find segments");
+    }
+
+    const std::size_t n = points.size();
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    const std::size_t chunk_size = std::max<std::size_t>(n / (threads * chunks_per_thread), 1);
+    const std::size_t chunks = (n + chunk_size - 1) / chunk_size;
+
+    //each thread takes the next chunk of anchors until all are done
+    std::vector<std::vector<Segment>> found(chunks);
+    std::atomic<std::size_t> next_chunk = 0;
+    auto work = [&]() {
+        std::vector<std::uint64_t> slopes;
+        std::vector<std::uint64_t> buffer;
+        slopes.reserve(n);
+        for (std::size_t c = next_chunk++; c < chunks; c = next_chunk++) {
+            const std::size_t last = std::min((c + 1) * chunk_size, n);
+            for (std::size_t i = c * chunk_size; i < last; ++i) {
+                find_from(points, i, slopes, buffer, found[c]);
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> pool;
+        for (std::size_t t = 1; t < std::min<std::size_t>(threads, chunks); ++t) {
+            pool.emplace_back(work);
+        }
+        work();
+    }  //join
+
+    //each segment is found once, by the chunk of its smallest point
+    std::vector<Segment> segments;
+    for (auto& segs : found) {
+        std::move(segs.begin(), segs.end(), std::back_inserter(segments));
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+/*
+ * Finds all maximal line segments through 4 or more of the points in a points file, with
+ * bounded memory
+ */
+void find_segments_out_of_core(const std::filesystem::path& file,
+                               const std::function<void(const Segment&)>& output,
+                               std::size_t memory_limit, const std::filesystem::path& temp_dir) {
+    constexpr std::size_t min_memory_limit = std::size_t{1} << 16;
+    memory_limit = std::max(memory_limit, min_memory_limit);
+
+    const TempDir temp{temp_dir};
+    const MappedPoints points{sort_points(MappedPoints{cache_points(file)}, temp, memory_limit)};
+    const std::size_t n = points.size();
+
+    //half of the memory for the items, the rest for the segments found from them; as many
+    //anchors per block as fit, at least one, whose items are spilled if they do not fit
+    const std::size_t max_items = memory_limit / 2 / sizeof(Item);
+    const std::size_t anchors = std::clamp<std::size_t>(max_items / std::max<std::size_t>(n, 1), 1,
+                                                        max_anchors);
+
+    std::vector<Item> items;
+    std::vector<Segment> segments;
+    for (std::size_t first = 0; first < n; first += anchors) {
+        const std::size_t last = std::min(first + anchors, n);
+
+        //each anchor pairs with the n - 1 other points
+        const std::size_t count = (last - first) * (n - 1);
+
+        if (count <= max_items) {
+            items.clear();
+            items.reserve(count);
+            pair_block(points, first, last, [&](const Item& item) { items.push_back(item); });
+            find_lines(points, first, items, segments);
+        } else {
+            find_lines_spilled(points, first, last, count, max_items, temp, items, segments);
+        }
+
+        //segments of later blocks start at larger points, so come later
+        std::sort(segments.begin(), segments.end());
+        for (const auto& segment : segments) {
+            output(segment);
+        }
+        segments.clear();
+    }
+}
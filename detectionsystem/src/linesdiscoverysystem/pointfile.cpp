@@ -0,0 +1,257 @@
+#include <linesdiscoverysystem/pointfile.h>
+
+#include <string>
+#include <optional>
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <functional>
+
+namespace {
+
+/*
+ * Binary points file, e.g. the copy of a points file: the header followed by the points, x and
+ * y as 32-bit integers, in the byte order of the machine that wrote it
+ */
+struct CacheHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t count;  //number of points
+};
+
+constexpr char cache_magic[4] = {'L', 'D', 'P', 'C'};
+constexpr std::uint32_t cache_version = 1;
+
+//points parsed before they are passed on, see parse_points
+constexpr std::size_t parse_block = 1 << 16;
+
+static_assert(sizeof(Point) == 2 * sizeof(std::int32_t), "points are stored as two int32");
+
+/*
+ * Checks the header of a binary points file
+ * Returns the number of points, or nothing if the file is not valid, e.g. partly written
+ */
+std::optional<std::size_t> point_count(std::span<const std::byte> bytes) {
+    CacheHeader header{};
+    if (bytes.size() < sizeof header) {
+        return std::nullopt;
+    }
+    std::memcpy(&header, bytes.data(), sizeof header);
+    if (std::memcmp(header.magic, cache_magic, sizeof cache_magic) != 0 ||
+        header.version != cache_version ||
+        (bytes.size() - sizeof header) / sizeof(Point) != header.count ||
+        (bytes.size() - sizeof header) % sizeof(Point) != 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(header.count);
+}
+
+//check whether the coordinates of p are in [0, max_coordinate], see Point
+bool in_range(const Point& p) {
+    return p.x >= 0 && p.x <= max_coordinate && p.y >= 0 && p.y <= max_coordinate;
+}
+
+//check whether all count points after the header of a binary points file are in range
+bool points_in_range(std::span<const std::byte> bytes, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        Point p;
+        std::memcpy(&p, bytes.data() + sizeof(CacheHeader) + i * sizeof(Point), sizeof p);
+        if (!in_range(p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//check whether the binary copy of file exists and is newer than file
+bool is_cache_current(const std::filesystem::path& file) {
+    std::error_code ec;
+    const auto cache_time = std::filesystem::last_write_time(point_cache_path(file), ec);
+    return !ec && cache_time >= std::filesystem::last_write_time(file);
+}
+
+/*
+ * Reads the points from the binary copy of file into points
+ * Returns false if there is no valid copy, or it is older than file
+ */
+bool read_cache(const std::filesystem::path& file, std::vector<Point>& points) {
+    if (!is_cache_current(file)) {
+        return false;
+    }
+
+    const MappedFile mapped{point_cache_path(file)};
+    const auto bytes = mapped.bytes();
+    const auto count = point_count(bytes);
+    if (!count) {
+        return false;
+    }
+
+    points.resize(*count);
+    if (!points.empty()) {
+        std::memcpy(points.data(), bytes.data() + sizeof(CacheHeader), *count * sizeof(Point));
+    }
+    if (!std::all_of(points.begin(), points.end(), in_range)) {
+        points.clear();  //parse the file again
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Writes the points to the binary copy of file
+ * The copy only saves time, so failing to write it, e.g. to a read-only directory, is no error
+ */
+void write_cache(const std::filesystem::path& file, const std::vector<Point>& points) {
+    try {
+        PointWriter out{point_cache_path(file)};
+        out.write(points);
+        out.close();
+    } catch (const std::runtime_error&) {
+    }
+}
+
+/*
+ * Parses the integer after the white space at first, and moves first past it
+ * Throws std::runtime_error if there is no integer
+ */
+int parse_int(const char*& first, const char* last, const std::filesystem::path& file) {
+    while (first != last &&
+           (*first == ' ' || *first == '\n' || *first == '\r' || *first == '\t')) {
+        ++first;
+    }
+
+    int value = 0;
+    const auto [end, ec] = std::from_chars(first, last, value);
+    if (ec != std::errc{}) {
+        throw std::runtime_error("Malformed points file " + file.string());
+    }
+    first = end;
+    return value;
+}
+
+/*
+ * Parses a coordinate of a point, see parse_int
+ * Throws std::runtime_error if there is no integer in [0, max_coordinate]
+ */
+int parse_coordinate(const char*& first, const char* last, const std::filesystem::path& file) {
+    const int value = parse_int(first, last, file);
+    if (value < 0 || value > max_coordinate) {
+        throw std::runtime_error("Malformed points file " + file.string());
+    }
+    return value;
+}
+
+/*
+ * Parses the points file, see load_points
+ * The points are passed to add in blocks of at most parse_block points, in file order
+ */
+void parse_points(const std::filesystem::path& file,
+                  const std::function<void(std::span<const Point>)>& add) {
+    const MappedFile mapped{file};
+    const auto bytes = mapped.bytes();
+    const char* first = reinterpret_cast<const char*>(bytes.data());
+    const char* last = first + bytes.size();
+
+    const int n_points = parse_int(first, last, file);
+    if (n_points < 0) {
+        throw std::runtime_error("Malformed points file " + file.string());
+    }
+
+    std::vector<Point> block;
+    block.reserve(std::min<std::size_t>(n_points, parse_block));
+    for (int i = 0; i < n_points; ++i) {
+        auto& p = block.emplace_back();
+        p.x = parse_coordinate(first, last, file);
+        p.y = parse_coordinate(first, last, file);
+        if (block.size() == parse_block) {
+            add(block);
+            block.clear();
+        }
+    }
+    add(block);
+}
+
+}  // namespace
+
+/*
+ * Reads all points from a points file, or from its binary copy
+ */
+std::vector<Point> load_points(const std::filesystem::path& file) {
+    std::vector<Point> points;
+    if (read_cache(file, points)) {
+        return points;
+    }
+
+    parse_points(file, [&](std::span<const Point> block) {
+        points.insert(points.end(), block.begin(), block.end());
+    });
+    write_cache(file, points);
+    return points;
+}
+
+std::filesystem::path point_cache_path(const std::filesystem::path& file) {
+    auto cache = file;
+    cache += ".bin";
+    return cache;
+}
+
+/*
+ * Writes the binary copy of a points file block by block, unless it is up to date
+ */
+std::filesystem::path cache_points(const std::filesystem::path& file) {
+    const auto cache = point_cache_path(file);
+    if (is_cache_current(file)) {
+        const MappedFile mapped{cache};
+        const auto count = point_count(mapped.bytes());
+        if (count && points_in_range(mapped.bytes(), *count)) {
+            return cache;
+        }
+    }
+
+    PointWriter out{cache};
+    parse_points(file, [&](std::span<const Point> block) { out.write(block); });
+    out.close();
+    return cache;
+}
+
+/*
+ * Maps the given binary points file
+ */
+MappedPoints::MappedPoints(const std::filesystem::path& file) : file_{file} {
+    const auto count = point_count(file_.bytes());
+    if (!count) {
+        throw std::runtime_error("Malformed binary points file " + file.string());
+    }
+    points_ = file_.bytes().data() + sizeof(CacheHeader);
+    size_ = *count;
+}
+
+/*
+ * Creates the given file, with a header that is only made valid by close
+ */
+PointWriter::PointWriter(const std::filesystem::path& file)
+    : file_{file}, out_{file, std::ios::binary | std::ios::trunc} {
+    if (!out_) {
+        throw std::runtime_error("Unable to write file " + file_.string());
+    }
+    const CacheHeader header{};  //no magic yet
+    out_.write(reinterpret_cast<const char*>(&header), sizeof header);
+}
+
+void PointWriter::write(std::span<const Point> points) {
+    out_.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(Point));
+    count_ += points.size();
+}
+
+void PointWriter::close() {
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof cache_magic);
+    header.version = cache_version;
+    header.count = count_;
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof header);
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("Unable to write file " + file_.string());
+    }
+}
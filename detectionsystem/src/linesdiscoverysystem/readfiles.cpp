@@ -1,9 +1,11 @@
 #include <linesdiscoverysystem/readfiles.h>
+#include <linesdiscoverysystem/pointfile.h>
 
 #include <cassert>
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <stdexcept>
 
 
 std::vector<rendering::Point> readLineSegments(std::ifstream& file) {
@@ -37,19 +39,18 @@ std::vector<rendering::Point> readLineSegments(const std::filesystem::path& file
     return readLineSegments(linesFile);
 }
 
-std::vector<rendering::Point> readPoints(std::istream& is) {
-    int n_points{0};
-    is >> n_points;  // read number of particles
-
-    std::vector<rendering::Point> points;
-    points.reserve(n_points);
-    for (int i = 0; i < n_points; ++i) {
-        auto& p = points.emplace_back(glm::vec2{}, glm::vec4{1.0f, 1.0f, 0.0f, 1.0f}, 0.002f);
-        is >> p.position.x >> p.position.y;
-        p.position.x /= 32767.0;
-        p.position.y /= 32767.0;
+/*
+ * Converts points, e.g. as read by load_points, to points that can be rendered
+ */
+std::vector<rendering::Point> readPoints(std::span<const Point> points) {
+    std::vector<rendering::Point> renderPoints;
+    renderPoints.reserve(points.size());
+    for (const auto& point : points) {
+        auto& p = renderPoints.emplace_back(glm::vec2{}, glm::vec4{1.0f, 1.0f, 0.0f, 1.0f}, 0.002f);
+        p.position.x = point.x / 32767.0f;
+        p.position.y = point.y / 32767.0f;
     }
-    return points;
+    return renderPoints;
 }
 
 /*
@@ -57,10 +58,10 @@ std::vector<rendering::Point> readPoints(std::istream& is) {
  * Returns a vector of points that can be rendered
  */
 std::vector<rendering::Point> readPoints(const std::filesystem::path& file) {
-    std::ifstream pointsFile(file);
-    if (!pointsFile) {
+    try {
+        return readPoints(load_points(file));
+    } catch (const std::runtime_error&) {
         std::cout << "Points file error!!\n";
         return {};
     }
-    return readPoints(pointsFile);
 }